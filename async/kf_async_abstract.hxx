@@ -6,11 +6,13 @@
 typedef void* KASYNCOBJECT;
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_ASYNC_CALLBACK "kf_iid_async_callback"
-#define _KF_INTERFACE_ID_ASYNC_RESULT "kf_iid_async_result"
+#define _KF_INTERFACE_ID_ASYNC_CALLBACK _KF_IID("kf_iid_async_callback")
+#define _KF_INTERFACE_ID_ASYNC_RESULT _KF_IID("kf_iid_async_result")
+#define _KF_INTERFACE_ID_ASYNC_CANCEL_TOKEN _KF_IID("kf_iid_async_cancel_token")
 #else
-#define _KF_INTERFACE_ID_ASYNC_CALLBACK "1D14A9A529274CE3AD1AB69368B24132"
-#define _KF_INTERFACE_ID_ASYNC_RESULT "8092C9DB2A414C43AD6496B82F50C0DC"
+#define _KF_INTERFACE_ID_ASYNC_CALLBACK _KF_IID("1D14A9A529274CE3AD1AB69368B24132")
+#define _KF_INTERFACE_ID_ASYNC_RESULT _KF_IID("8092C9DB2A414C43AD6496B82F50C0DC")
+#define _KF_INTERFACE_ID_ASYNC_CANCEL_TOKEN _KF_IID("6E2B0F4A93D1472C8F5C1A7D0B3E9264")
 #endif
 
 // ***** Async Interfaces ***** //
@@ -32,13 +34,33 @@ struct IKFAsyncCallback : public IKFBaseObject
     virtual void Execute(IKFAsyncResult* pResult) = 0; //实现这个接口，工作队列会去执行这个方法
 };
 
+//取消令牌：提交任务时关联（一个令牌可以关联多个任务），Cancel 以后还在排队的任务不会再执行，已经开始执行的任务不受影响
+struct IKFAsyncCancelToken : public IKFBaseObject
+{
+    virtual void Cancel() = 0;
+    virtual bool IsCancelled() = 0;
+};
+
 // ***** Async Functions ***** //
 
 #define KF_ASYNC_WORKER_THREADS_INFINITE           -1 //在 KFAsyncCreateWorker 的时候打开 parallel 选项才可使用
 
+//工作线程任务队列空了以后的等待策略
+#define KF_ASYNC_IDLE_PARK                         0 //立即等待事件（默认，不占用 CPU）
+#define KF_ASYNC_IDLE_YIELD_PARK                   1 //先让出线程若干次，再等待事件
+#define KF_ASYNC_IDLE_SPIN_YIELD_PARK              2 //先自旋，再让出线程，最后等待事件（延迟最低，空闲时会占用 CPU）
+
 #define KF_ASYNC_GLOBAL_WORKER_SINGLE_THREAD       ((void*)1)
 #define KF_ASYNC_GLOBAL_WORKER_MULTI_THREAD        ((void*)2)
 
+//任务优先级：高优先级的任务先执行，同一优先级内保持 FIFO，低优先级的任务不会被无限期饿死
+#define KF_ASYNC_PRIORITY_LOW                      0 //后台批量任务
+#define KF_ASYNC_PRIORITY_NORMAL                   1 //KFAsyncPutWorkItem/KFAsyncPutWorkItemEx 的默认优先级
+#define KF_ASYNC_PRIORITY_HIGH                     2
+#define KF_ASYNC_PRIORITY_REALTIME                 3 //延迟敏感的任务
+#define KF_ASYNC_PRIORITY_LEVELS                   4
+#define KF_ASYNC_PRIORITY_ALL                      -1 //只用于 KFAsyncGetWorkerQueueDepth
+
 //初始化异步核心（线程安全）
 bool KFAPI KFAsyncStartup();
 bool KFAPI KFAsyncLockRef(); // -> 自动做KFAsyncStartup
@@ -47,7 +69,48 @@ void KFAPI KFAsyncShutdown();
 void KFAPI KFAsyncUnlockRef(); // -> 等于KFAsyncShutdown
 
 //创建一个异步队列工作者对象（线程不安全）
-KF_RESULT KFAPI KFAsyncCreateWorker(bool parallel, int max_threads, KASYNCOBJECT* asyncObject, const char* worker_name = nullptr);
+KF_RESULT KFAPI KFAsyncCreateWorker(bool parallel, int max_threads, KASYNCOBJECT* asyncObject, const char* worker_name = nullptr, int idle_policy = KF_ASYNC_IDLE_PARK);
+//Worker 线程绑定 CPU 的方式
+#define KF_ASYNC_AFFINITY_NONE                     0 //不绑定（默认）
+#define KF_ASYNC_AFFINITY_CPU_SET                  1 //所有线程都限制在 AffinityCpus 中运行
+#define KF_ASYNC_AFFINITY_PIN_CORE                 2 //第 i 个线程绑定到 AffinityCpus[i % AffinityCpuCount]（没有指定 CPU 则为所有 CPU）
+#define KF_ASYNC_AFFINITY_SPREAD_NUMA              3 //第 i 个线程绑定到第 i % 节点数 个 NUMA 节点的所有 CPU
+
+//KFAsyncCreateWorkerEx 的线程池配置
+#define KF_ASYNC_KEEP_ALIVE_DEFAULT                0 //空闲 60 秒后退出
+#define KF_ASYNC_KEEP_ALIVE_INFINITE               -1 //空闲的线程不退出
+#define KF_ASYNC_STALL_TIMEOUT_DEFAULT             0 //一个任务执行超过 2 秒视为阻塞
+#define KF_ASYNC_STALL_TIMEOUT_DISABLED            -1 //不检测阻塞
+#define KF_ASYNC_QUEUE_CAPACITY_UNLIMITED          0
+//排队的任务数达到 QueueCapacity 以后的处理方式
+#define KF_ASYNC_OVERFLOW_REJECT                   0 //提交失败，返回 KF_BUF_TOO_SMALL
+#define KF_ASYNC_OVERFLOW_BLOCK                    1 //提交的线程等待，超时返回 KF_TIMEOUT（Worker 自己的线程提交时不等待，直接入队）
+#define KF_ASYNC_OVERFLOW_DROP_OLDEST              2 //丢弃排队最久的任务（最忙的线程最低优先级队列的第一个），不调用 Callback
+#define KF_ASYNC_OVERFLOW_CALLER_RUNS              3 //在提交的线程上直接执行
+struct KFAsyncWorkerConfig
+{
+    bool Parallel; //false 表示单线程的 FIFO Worker（忽略 MinThreads/MaxThreads）
+    int MinThreads; //创建时立即启动的线程数，这些线程空闲时不会退出
+    int MaxThreads; //同 KFAsyncCreateWorker 的 max_threads（<= 0 根据 CPU 核心数决定，或者 KF_ASYNC_WORKER_THREADS_INFINITE）
+    int KeepAliveMs; //超过 MinThreads 的线程空闲多久后退出（KF_ASYNC_KEEP_ALIVE_*）
+    int IdlePolicy; //KF_ASYNC_IDLE_*
+    const char* Name; //可以为 nullptr
+    int AffinityMode; //KF_ASYNC_AFFINITY_*（CPU_SET/PIN_CORE 并且 MaxThreads <= 0 时，最大线程数为 CPU 个数）
+    const int* AffinityCpus; //CPU 编号，只在创建时使用（会被复制）
+    int AffinityCpuCount;
+    int StallTimeoutMs; //并行 Worker 的阻塞检测：线程执行一个任务超过这个时间，排在它后面的任务会迁移到别的线程（KF_ASYNC_STALL_TIMEOUT_*）
+    int QueueCapacity; //最多排队（还没开始执行）的任务数（KF_ASYNC_QUEUE_CAPACITY_UNLIMITED 表示不限制）
+    int OverflowPolicy; //KF_ASYNC_OVERFLOW_*
+    int OverflowBlockTimeoutMs; //KF_ASYNC_OVERFLOW_BLOCK 最多等待的时间（<= 0 表示一直等待）
+};
+//根据配置创建一个异步队列工作者对象（线程不安全）
+KF_RESULT KFAPI KFAsyncCreateWorkerEx(const KFAsyncWorkerConfig* config, KASYNCOBJECT* asyncObject);
+//创建一个 Strand：提交到 Strand 的任务按照 FIFO 顺序、同一时刻只执行一个（和单线程的 Worker 一样），
+//但是不创建线程，而是借用 pool 的线程执行（pool 为 nullptr 表示 KF_ASYNC_GLOBAL_WORKER_MULTI_THREAD，需要先 KFAsyncStartup）
+//返回的 KASYNCOBJECT 可以用于所有的 KFAsyncPut* 函数，用 KFAsyncDestroyWorker 销毁，Strand 存在期间 pool 不会被真正销毁（线程不安全）
+KF_RESULT KFAPI KFAsyncCreateStrand(KASYNCOBJECT pool, KASYNCOBJECT* strand, const char* strand_name = nullptr);
+//预热：立即创建并启动线程，直到 Worker 有 threads 个（不超过最大线程数）正在运行的线程，避免突发流量时在提交路径上创建线程
+KF_RESULT KFAPI KFAsyncPrewarmWorker(KASYNCOBJECT worker, int threads);
 //销毁一个异步队列工作者对象（注意：这个函数返回后，工作者的线程组并没有立即全部退出，但是KASYNCOBJECT已经无效。）（线程不安全）
 KF_RESULT KFAPI KFAsyncDestroyWorker(KASYNCOBJECT worker);
 //取得最大的 Worker 的线程总数（线程不安全）
@@ -55,12 +118,86 @@ KF_RESULT KFAPI KFAsyncGetWorkerMaxThreads(KASYNCOBJECT worker, int* threads);
 //取得 Worker 的名称，如果有的话（线程不安全）
 KF_RESULT KFAPI KFAsyncGetWorkerName(KASYNCOBJECT worker, char* worker_name, int* name_len);
 
+//Worker 线程在空闲等待的各个阶段接到下一个任务的次数（所有线程的累计值）
+struct KFAsyncIdleStats
+{
+    KF_INT64 SpinHits; //自旋阶段接到任务
+    KF_INT64 YieldHits; //让出线程阶段接到任务
+    KF_INT64 ParkWakeups; //等待事件后被唤醒
+};
+//取得 Worker 的空闲等待统计（线程安全，只是一个瞬时值）
+KF_RESULT KFAPI KFAsyncGetWorkerIdleStats(KASYNCOBJECT worker, KFAsyncIdleStats* stats);
+
 //根据用户提供的 Callback 组件，创建一个可供提交到异步工作者中的执行体对象 (IKFAsyncResult)
 KF_RESULT KFAPI KFAsyncCreateResult(IKFAsyncCallback* callback, IKFBaseObject* state, IKFBaseObject* object, IKFAsyncResult** asyncResult);
 //提交执行体对象 IKFAsyncResult 到工作队列中执行（会保证顺序遵循FIFO）
 KF_RESULT KFAPI KFAsyncPutWorkItemEx(KASYNCOBJECT worker, IKFAsyncResult* result);
+//提交任务时的可选项
+#define KF_ASYNC_DEADLINE_NONE                     0
+struct KFAsyncWorkItemOptions
+{
+    int Priority; //KF_ASYNC_PRIORITY_*
+    IKFAsyncCancelToken* CancelToken; //可以为 nullptr
+    int DeadlineMs; //从提交开始计算，超过这个时间还没有开始执行的任务会被丢弃（KF_ASYNC_DEADLINE_NONE 表示没有期限）
+};
+//按照可选项提交执行体对象：已经取消或者超过期限的任务在执行之前被丢弃（不会调用 Callback），计入 KFAsyncGetWorkerDropStats
+KF_RESULT KFAPI KFAsyncPutWorkItemWithOptions(KASYNCOBJECT worker, IKFAsyncResult* result, const KFAsyncWorkItemOptions* options);
+KF_RESULT KFAPI KFAsyncCreateCancelToken(IKFAsyncCancelToken** token);
+
+//Worker 丢弃的任务数（所有线程的累计值）
+struct KFAsyncDropStats
+{
+    KF_INT64 Cancelled; //取消令牌已经被 Cancel
+    KF_INT64 Expired; //超过了 DeadlineMs
+    KF_INT64 Overflowed; //队列满了被 KF_ASYNC_OVERFLOW_DROP_OLDEST 丢弃
+};
+KF_RESULT KFAPI KFAsyncGetWorkerDropStats(KASYNCOBJECT worker, KFAsyncDropStats* stats);
 //直接根据 Callback 提交到工作队列中执行，内部会自动创建 IKFAsyncResult 对象
 KF_RESULT KFAPI KFAsyncPutWorkItem(KASYNCOBJECT worker, IKFAsyncCallback* callback, IKFBaseObject* state);
+//按照指定的优先级（KF_ASYNC_PRIORITY_*）提交执行体对象，O(1) 插入到对应优先级的队列尾
+KF_RESULT KFAPI KFAsyncPutWorkItemWithPriority(KASYNCOBJECT worker, IKFAsyncResult* result, int priority);
+//批量提交执行体对象：只锁一次线程组，每个线程只通知一次，并行的 Worker 会把任务分散到多个线程（同一个线程内保持 FIFO）
+KF_RESULT KFAPI KFAsyncPutWorkItemBatch(KASYNCOBJECT worker, IKFAsyncResult** results, int count);
+//批量提交 Callback，states 可以为 nullptr，否则和 callbacks 一一对应
+KF_RESULT KFAPI KFAsyncPutWorkItemBatchCallbacks(KASYNCOBJECT worker, IKFAsyncCallback** callbacks, IKFBaseObject** states, int count);
+//提交一个函数指针到工作队列中执行：不创建 IKFAsyncResult，也不做引用计数（WorkItem 来自内存池）
+//context 需要保证在 func 执行之前一直有效，Worker 销毁时还没有执行的函数会被丢弃（不会调用）
+typedef void (*KFAsyncWorkFunc)(void* context);
+KF_RESULT KFAPI KFAsyncPutWorkFunction(KASYNCOBJECT worker, KFAsyncWorkFunc func, void* context);
+//提交一定会有结果的函数：不会被 KF_ASYNC_OVERFLOW_DROP_OLDEST 丢弃，总是排到队列尾部（KF_ASYNC_OVERFLOW_CALLER_RUNS 也不在提交的线程上执行）
+//Worker 关闭时被丢弃会在丢弃的线程上调用 discard，func 和 discard 只会调用其中一个（discard 不能为 nullptr）
+KF_RESULT KFAPI KFAsyncPutNoDropFunction(KASYNCOBJECT worker, KFAsyncWorkFunc func, KFAsyncWorkFunc discard, void* context);
+//提交一个存放在 WorkItem 内部缓冲区的可调用对象（一般通过 kf_async_post.hxx 的 KFAsyncPost 使用）
+//Construct 在缓冲区上构造对象（source 原样传入），执行完或者被丢弃以后 WorkItem 释放时调用 Destroy
+#define KF_ASYNC_INLINE_FUNC_SIZE                  48 //缓冲区的大小（按照 std::max_align_t 对齐）
+struct KFAsyncInlineFuncOps
+{
+    bool (*Construct)(void* storage, void* source); //失败返回 false（不会再调用 Destroy）
+    void (*Invoke)(void* storage);
+    void (*Destroy)(void* storage);
+};
+KF_RESULT KFAPI KFAsyncPutInlineFunction(KASYNCOBJECT worker, const KFAsyncInlineFuncOps* ops, void* source, int priority);
+//取得 Worker 中某个优先级（KF_ASYNC_PRIORITY_ALL 表示全部）正在排队的任务数，只是一个瞬时值
+KF_RESULT KFAPI KFAsyncGetWorkerQueueDepth(KASYNCOBJECT worker, int priority, int* depth);
+//再提交 count 个任务是否会触发 QueueCapacity 的溢出处理（没有限制容量的 Worker 总是返回 false），只读一个计数
+bool KFAPI KFAsyncWorkerWouldBlock(KASYNCOBJECT worker, int count = 1);
+//Worker 的运行统计（时间单位都是微秒），每个线程各自计数，读取时汇总，不影响提交和执行
+#define KF_ASYNC_STATS_MAX_THREADS                 64 //KFAsyncWorkerStats 最多列出的线程数
+#define KF_ASYNC_STATS_WAIT_BUCKETS                32 //等待时间直方图：第 i 个桶为 [2^i, 2^(i+1)) 微秒（第 0 个桶从 0 开始）
+struct KFAsyncWorkerStats
+{
+    int CurrentThreads; //当前的线程数
+    int ListedThreads; //ThreadQueueDepth 中有效的个数
+    int ThreadQueueDepth[KF_ASYNC_STATS_MAX_THREADS]; //每个线程待执行的任务数
+    KF_INT64 Executed; //执行完的任务数（不包括被丢弃的任务）
+    KF_INT64 BusyTimeUs; //执行任务的总时间
+    KF_INT64 WaitTimeUs; //任务从提交到开始执行的等待时间总和
+    KF_INT64 WaitMaxUs;
+    KF_INT64 WaitP50Us, WaitP90Us, WaitP99Us; //根据直方图估算（所在桶的上界）
+    KF_INT64 WaitHistogram[KF_ASYNC_STATS_WAIT_BUCKETS];
+};
+//取得 Worker 的运行统计快照（线程安全，只是一个瞬时值）
+KF_RESULT KFAPI KFAsyncGetWorkerStats(KASYNCOBJECT worker, KFAsyncWorkerStats* stats);
 //异步调用一个 Callback，这个调用会分发到默认的工作队列中执行（KFAsyncStartup 后创建的线程组）
 KF_RESULT KFAPI KFAsyncInvokeCallback(IKFAsyncResult* result);
 
@@ -2,6 +2,8 @@
 #include <base/kf_base.hxx>
 #include <base/kf_log.hxx>
 #include <base/kf_array_list.hxx>
+#include <utils/mpsc_queue.hxx>
+#include <utils/object_pool.hxx>
 #include <async/kf_thread_object.hxx>
 #include <async/kf_async_internal.hxx>
 
@@ -25,19 +27,236 @@ KF_RESULT KFAsyncInvokeCallback_Win32_MF(IKFAsyncResult*);
 
 #define WORKER_EXIT_TIMEOUT (60 * 1000)
 #define MAX_OVERFLOW_THREAD_COUNT 10
+#define WORKER_STEAL_MAX_COUNT 64 //一次最多偷走的任务数
+#define WORKER_STEAL_PROBE_COUNT 4 //空闲线程每次偷任务最多探测的线程数
+#define WORKER_IDLE_SPIN_COUNT 4000 //KF_ASYNC_IDLE_SPIN_YIELD_PARK 自旋检查队列的次数
+#define WORKER_IDLE_YIELD_COUNT 32 //KF_ASYNC_IDLE_*YIELD_PARK 让出线程检查队列的次数
+#define WORKER_PRIORITY_AGING_LIMIT 8 //低优先级的任务最多连续被高优先级的任务插队的次数
+#define WORKER_STALL_TIMEOUT 2000 //KF_ASYNC_STALL_TIMEOUT_DEFAULT
+#define WORKER_WATCHDOG_INTERVAL 100 //watchdog 检查阻塞线程的间隔
+#define WORKER_LIFO_SLOT_LIMIT 8 //连续执行 LIFO 槽里的任务的最多次数（之后让队列里的任务先执行）
+#define WORKER_STRAND_BATCH_COUNT 64 //Strand 一次 Drain 最多连续执行的任务数
+
+static const int kSystemCpuCount = KFSystemCpuCount();
+
+//统计用的时刻（微秒），单调时钟，系统时间调整不会产生负数或者巨大的等待时间
+static inline KF_INT64 KFAsyncNowUs() throw() { return KFGetMonotonicNs() / 1000; }
+
+static_assert(KF_ASYNC_PRIORITY_LEVELS == IKFAsyncThreadWorker_I::WorkItemLevelCount, "KF_ASYNC_PRIORITY_LEVELS");
+
+class AsyncCancelToken : public IKFAsyncCancelToken
+{
+    KF_IMPL_DECL_REFCOUNT;
+
+    std::atomic<bool> _cancelled;
+
+public:
+    AsyncCancelToken() throw() : _ref_count(1), _cancelled(false) {}
+    virtual ~AsyncCancelToken() throw() {}
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_ASYNC_CANCEL_TOKEN)) {
+            *ppv = static_cast<IKFAsyncCancelToken*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+
+    virtual KREF Retain()
+    { KF_IMPL_RETAIN_FUNC(_ref_count); }
+    virtual KREF Recycle()
+    { KF_IMPL_RECYCLE_FUNC(_ref_count); }
+
+public:
+    virtual void Cancel() { _cancelled.store(true, std::memory_order_release); }
+    virtual bool IsCancelled() { return _cancelled.load(std::memory_order_acquire); }
+};
+
+// ***************
+
+//任务的执行统计：每个 ThreadWorker（或者 StrandWorker）一份，只有执行任务的一方写入（不需要原子加），读取时汇总
+struct WorkerExecStats
+{
+    std::atomic<KF_INT64> Executed, BusyTimeUs, WaitTimeUs, WaitMaxUs;
+    std::atomic<KF_INT64> WaitHistogram[KF_ASYNC_STATS_WAIT_BUCKETS];
+
+    WorkerExecStats() throw() : Executed(0), BusyTimeUs(0), WaitTimeUs(0), WaitMaxUs(0)
+    { for (auto& bucket : WaitHistogram) bucket.store(0, std::memory_order_relaxed); }
+
+    static int WaitBucket(KF_INT64 wait_us) throw()
+    {
+        int bucket = 0;
+        while (wait_us > 1 && bucket < KF_ASYNC_STATS_WAIT_BUCKETS - 1) {
+            wait_us >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    void OnExecuted(KF_INT64 wait_us, KF_INT64 busy_us) throw()
+    {
+        if (wait_us < 0) wait_us = 0; //系统时间被调整
+        if (busy_us < 0) busy_us = 0;
+        Executed.store(Executed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        BusyTimeUs.store(BusyTimeUs.load(std::memory_order_relaxed) + busy_us, std::memory_order_relaxed);
+        WaitTimeUs.store(WaitTimeUs.load(std::memory_order_relaxed) + wait_us, std::memory_order_relaxed);
+        if (wait_us > WaitMaxUs.load(std::memory_order_relaxed))
+            WaitMaxUs.store(wait_us, std::memory_order_relaxed);
+        auto& bucket = WaitHistogram[WaitBucket(wait_us)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void AddTo(KFAsyncWorkerStats* stats) const throw()
+    {
+        stats->Executed += Executed.load(std::memory_order_relaxed);
+        stats->BusyTimeUs += BusyTimeUs.load(std::memory_order_relaxed);
+        stats->WaitTimeUs += WaitTimeUs.load(std::memory_order_relaxed);
+        auto max = WaitMaxUs.load(std::memory_order_relaxed);
+        if (max > stats->WaitMaxUs)
+            stats->WaitMaxUs = max;
+        for (int i = 0; i < KF_ASYNC_STATS_WAIT_BUCKETS; i++)
+            stats->WaitHistogram[i] += WaitHistogram[i].load(std::memory_order_relaxed);
+    }
+};
+
+// ***************
+
+//线程组排队任务数的上限（KFAsyncWorkerConfig::QueueCapacity）：提交时占用名额，线程取出任务（执行或者丢弃）时归还
+//线程组和每个 ThreadWorker 各持有一个引用，线程组销毁以后还在执行的线程仍然可以归还名额
+class WorkerQueueLimit
+{
+    KF_IMPL_DECL_REFCOUNT;
+
+    std::atomic<int> _queued;
+    std::atomic<int> _waiters; //KF_ASYNC_OVERFLOW_BLOCK 正在等待的生产者
+    int _capacity;
+    KFMutex _mutex;
+    void* _cond;
+
+public:
+    explicit WorkerQueueLimit(int capacity) throw() : _ref_count(1), _queued(0), _waiters(0), _capacity(capacity), _mutex(true)
+    { _cond = KFCondVarCreate(); }
+    ~WorkerQueueLimit() throw()
+    { if (_cond) KFCondVarDestroy(_cond); }
+
+    KREF Retain() { KF_IMPL_RETAIN_FUNC(_ref_count); }
+    KREF Recycle() { KF_IMPL_RECYCLE_FUNC(_ref_count); }
+
+    bool IsValid() throw() { return _cond != nullptr && _mutex.Get() != nullptr; }
+
+    //超过容量的一批任务只在队列为空时接受
+    bool WouldBlock(int count) const throw()
+    {
+        int queued = _queued.load(std::memory_order_relaxed);
+        return queued > 0 && queued + count > _capacity;
+    }
+
+    bool TryAcquire(int count) throw()
+    {
+        int queued = _queued.load();
+        while (queued == 0 || queued + count <= _capacity) {
+            if (_queued.compare_exchange_weak(queued, queued + count))
+                return true;
+        }
+        return false;
+    }
+
+    void ForceAcquire(int count) throw() { _queued.fetch_add(count); }
+
+    KF_RESULT AcquireWait(int count, int timeout_ms)
+    {
+        KF_INT64 deadline = timeout_ms > 0 ? KFGetTick() + timeout_ms : 0;
+        KF_RESULT r = KF_OK;
+        KFMutex::AutoLock lock(_mutex);
+        _waiters.fetch_add(1);
+        while (!TryAcquire(count)) {
+            if (timeout_ms <= 0) {
+                KFCondVarWait(_cond, _mutex.Get());
+                continue;
+            }
+            auto remain = deadline - KFGetTick();
+            if (remain <= 0) {
+                r = KF_TIMEOUT;
+                break;
+            }
+            KFCondVarWaitTimed(_cond, _mutex.Get(), (int)remain);
+        }
+        _waiters.fetch_sub(1);
+        return r;
+    }
+
+    void Release(int count)
+    {
+        _queued.fetch_sub(count);
+        if (_waiters.load() > 0) {
+            KFMutex::AutoLock lock(_mutex);
+            KFCondVarBroadcast(_cond);
+        }
+    }
+};
+
+// ***************
 
 class WorkItem : public IKFAsyncWorkItem_I
 {
     KF_IMPL_DECL_REFCOUNT;
+    KF_IMPL_OBJECT_POOL(WorkItem); //每次提交任务都会创建，从内存池分配
 
     IKFAsyncWorkItem_I::WorkItemState _state;
     IKFAsyncResult_I* _result;
+    KFAsyncWorkFunc _func;
+    KFAsyncWorkFunc _discard; //没有执行就被丢弃时调用（参数是 _context）
+    void* _context;
+    IKFAsyncCancelToken* _cancel_token;
+    KF_INT64 _deadline; //KFGetTick 的时刻，0 表示没有期限
+    KF_INT64 _enqueue_time; //KFAsyncNowUs 的时刻（微秒），用于统计等待时间
+    KFAsyncQueueNode _node;
+    int _priority;
+    const KFAsyncInlineFuncOps* _inline_ops; //KFAsyncPutInlineFunction 的可调用对象，构造成功以后才设置
+    alignas(std::max_align_t) unsigned char _inline_storage[KF_ASYNC_INLINE_FUNC_SIZE];
 
 public:
-    WorkItem(IKFAsyncWorkItem_I::WorkItemState state, IKFAsyncResult_I* result) throw() : _ref_count(1), _state(state)
-    { if (result) result->Retain(); _result = result; }
+    WorkItem(IKFAsyncWorkItem_I::WorkItemState state, IKFAsyncResult_I* result, int priority) throw() : _ref_count(1), _state(state), _func(nullptr), _discard(nullptr), _context(nullptr), _cancel_token(nullptr), _deadline(0), _enqueue_time(KFAsyncNowUs()), _priority(priority), _inline_ops(nullptr)
+    { if (result) result->Retain(); _result = result; _node.Next.store(nullptr, std::memory_order_relaxed); _node.Item = this; }
+    WorkItem(KFAsyncWorkFunc func, void* context, int priority) throw() :
+        _ref_count(1), _state(IKFAsyncWorkItem_I::WorkItemState::ExecuteFunction), _result(nullptr), _func(func), _discard(nullptr), _context(context), _cancel_token(nullptr), _deadline(0), _enqueue_time(KFAsyncNowUs()), _priority(priority), _inline_ops(nullptr)
+    { _node.Next.store(nullptr, std::memory_order_relaxed); _node.Item = this; }
     virtual ~WorkItem() throw()
-    { if (_result) _result->Recycle(); }
+    {
+        if (_inline_ops) _inline_ops->Destroy(_inline_storage);
+        if (_result) _result->Recycle();
+        if (_cancel_token) _cancel_token->Recycle();
+    }
+
+    //创建一个执行内部缓冲区中可调用对象的 WorkItem，构造失败返回 nullptr
+    static WorkItem* CreateInline(const KFAsyncInlineFuncOps* ops, void* source, int priority) throw()
+    {
+        auto workItem = new(std::nothrow) WorkItem(nullptr, nullptr, priority);
+        if (workItem == nullptr)
+            return nullptr;
+        if (!ops->Construct(workItem->_inline_storage, source)) {
+            workItem->Recycle();
+            return nullptr;
+        }
+        workItem->_inline_ops = ops;
+        return workItem;
+    }
+
+    void SetDiscardHandler(KFAsyncWorkFunc discard) throw() { _discard = discard; }
+
+    void SetDropCondition(IKFAsyncCancelToken* token, int deadline_ms) throw()
+    {
+        if (token)
+            token->Retain();
+        _cancel_token = token;
+        if (deadline_ms > 0)
+            _deadline = KFGetTick() + deadline_ms;
+    }
 
 public:
     virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
@@ -67,38 +286,168 @@ public:
         (*result)->Retain();
         return true;
     }
+    virtual IKFAsyncResult_I* PeekAsyncResult() { return _result; }
+    virtual void InvokeFunction()
+    {
+        if (_inline_ops)
+            _inline_ops->Invoke(_inline_storage);
+        else if (_func)
+            _func(_context);
+    }
+    virtual DropReason CheckDrop()
+    {
+        if (_cancel_token && _cancel_token->IsCancelled())
+            return DropCancelled;
+        if (_deadline > 0 && KFGetTick() > _deadline)
+            return DropExpired;
+        return NotDropped;
+    }
+    virtual KFAsyncQueueNode* GetQueueNode() { return &_node; }
+    virtual bool IsOverflowExempt() { return _discard != nullptr; }
+    virtual void OnDiscarded()
+    {
+        auto discard = _discard;
+        _discard = nullptr; //只通知一次
+        if (discard)
+            discard(_context);
+    }
+    virtual int GetPriority() { return _priority; }
+    virtual KF_INT64 GetEnqueueTime() { return _enqueue_time; }
 };
 
+//在当前线程执行一个 WorkItem（已经检查过丢弃条件），Strand 和 KF_ASYNC_OVERFLOW_CALLER_RUNS 使用
+static void KFAsyncRunWorkItem(IKFAsyncWorkItem_I* workItem)
+{
+    auto command = workItem->GetItemState();
+    if (command == IKFAsyncWorkItem_I::WorkItemState::ExecuteFunction) {
+        workItem->InvokeFunction();
+        return;
+    }
+
+    //WorkItem 持有 Result，执行期间不需要再增加 Result 的引用计数
+    auto result = command == IKFAsyncWorkItem_I::WorkItemState::ExecuteTask ? workItem->PeekAsyncResult() : nullptr;
+    if (result == nullptr) {
+        KFLOG_WARN_T("%s -> KFAsyncRunWorkItem: AsyncResult is Empty.", "WorkItem");
+        return;
+    }
+    IKFAsyncCallback* callback = nullptr;
+    result->GetCallback(&callback); //Callback 可能在执行期间被 SetCallback 替换，持有引用直到执行完
+    callback->Execute(result); //执行 Callback！
+    callback->Recycle();
+}
+
 // ***************
 
+class ThreadWorker;
+static thread_local ThreadWorker* kCurrentThreadWorker = nullptr; //当前线程正在运行的 ThreadWorker（不是 Worker 的线程为 nullptr）
+static thread_local KF_UINT32 kStealProbeSeed = 0; //偷任务时随机选择探测起点（xorshift）
+
 class ThreadWorker : public IKFAsyncThreadWorker_I, protected KFThreadObject
 {
     KF_IMPL_DECL_REFCOUNT;
 
-    IKFArrayList* _task_queue; //任务队列存储对象
-    void* _task_notify_event; //通知有任务到达了，需要执行
-    bool _thread_running; //任务线程是否在运行中
+    enum ThreadState
+    {
+        ThreadStopped, //线程没有运行，提交任务的一方负责启动线程
+        ThreadRunning, //线程正在执行任务
+        ThreadParked,  //线程在等待事件，提交任务的一方负责通知事件
+        ThreadExited   //任务队列已经关闭
+    };
+
+    struct TaskBand
+    {
+        MpscQueue<KFAsyncQueueNode> Queue; //无锁任务队列（生产者任意线程，消费者为本线程或者偷任务的线程）
+        std::atomic<int> Count; //这个优先级待执行的任务数
+        int Skipped; //有任务但是被更高优先级插队的次数（只有消费者访问）
+    };
+
+    TaskBand _bands[WorkItemLevelCount]; //每个优先级一个 FIFO 队列
+    std::atomic<int> _task_count; //所有优先级待执行的任务总数
+    std::atomic<int> _consumer_lock; //任务队列的消费者身份（本线程取任务、别的线程偷任务时持有）
+    std::atomic<int> _thread_state; //ThreadState
+    std::atomic<int> _exit_requested; //TaskQueueShutdown 请求退出
+    void* _task_notify_event; //通知有任务到达了，需要执行（只在线程 Parked 时才会被通知）
     int _timeout_ms; //多久没任务就退出线程（回收资源）
-    long long _cur_task_exec_start_time; //本次任务执行的开始时刻
+    int _idle_policy; //队列空了以后的等待策略（KF_ASYNC_IDLE_*）
+    std::atomic<KF_INT64> _spin_hits, _yield_hits, _park_wakeups; //空闲等待的各个阶段接到任务的次数
+    std::atomic<KF_INT64> _cancelled_drops, _expired_drops; //执行之前被丢弃的任务数
+    std::atomic<KF_INT64> _overflow_drops; //队列满了被丢弃的任务数
+    WorkerExecStats _exec_stats;
+    WorkerQueueLimit* _queue_limit; //线程组的排队容量（没有限制为 nullptr），取出任务时归还名额
+    std::atomic<long long> _cur_task_exec_start_time; //本次任务执行的开始时刻（watchdog 在别的线程读取）
     volatile KREF _task_has_moved; //本次线程的任务队列是不是已经被移动
+    volatile KREF _idle; //没有执行中的任务并且任务队列为空
+    IKFAsyncGroupWorker_I* _group; //所属的线程组（仅在 work-stealing 模式下设置，用于空闲时偷任务）
+    IKFAsyncGroupWorker_I* _owner; //创建这个线程的线程组（只用来判断是不是同一个线程组，不持有引用）
+    std::atomic<IKFAsyncWorkItem_I*> _lifo_slot; //本线程执行的任务提交给本线程组的最新一个任务，下一个执行（work-stealing 模式）
+    int _lifo_runs; //连续从 LIFO 槽执行的次数（只有本线程访问）
+    int* _affinity_cpus; //线程启动时绑定的 CPU
+    int _affinity_cpu_count;
 
-    KFMutex _mutex;
     char* _name;
 
 public:
     ThreadWorker() = delete;
     explicit ThreadWorker(const char* name) throw() :
         _ref_count(1),
-        _task_queue(nullptr),
+        _task_count(0),
+        _consumer_lock(0),
+        _thread_state(ThreadStopped),
+        _exit_requested(0),
         _task_notify_event(nullptr),
-        _thread_running(false),
         _name(nullptr),
         _timeout_ms(0),
+        _idle_policy(KF_ASYNC_IDLE_PARK),
+        _spin_hits(0),
+        _yield_hits(0),
+        _park_wakeups(0),
+        _cancelled_drops(0),
+        _expired_drops(0),
+        _overflow_drops(0),
+        _queue_limit(nullptr),
         _cur_task_exec_start_time(-1),
-        _task_has_moved(0)
-    { if (name) _name = strdup(name); }
+        _task_has_moved(0),
+        _idle(1),
+        _group(nullptr),
+        _owner(nullptr),
+        _lifo_slot(nullptr),
+        _lifo_runs(0),
+        _affinity_cpus(nullptr),
+        _affinity_cpu_count(0)
+    {
+        for (auto& band : _bands) {
+            band.Count.store(0, std::memory_order_relaxed);
+            band.Skipped = 0;
+        }
+        if (name) _name = strdup(name);
+    }
     virtual ~ThreadWorker() throw()
-    { if (_task_queue) _task_queue->Recycle(); if (_task_notify_event) KFEventDestroy(_task_notify_event); if (_name) free(_name); }
+    {
+        DropAllItems();
+        if (_task_notify_event) KFEventDestroy(_task_notify_event);
+        if (_group) _group->Recycle();
+        if (_queue_limit) _queue_limit->Recycle();
+        if (_affinity_cpus) free(_affinity_cpus);
+        if (_name) free(_name);
+    }
+
+    void SetStealGroup(IKFAsyncGroupWorker_I* group) throw()
+    { if (group) group->Retain(); _group = group; } //线程组 Shutdown 时会移除所有 ThreadWorker，循环引用在此时解除
+
+    void SetOwnerGroup(IKFAsyncGroupWorker_I* group) throw() { _owner = group; }
+    void SetQueueLimit(WorkerQueueLimit* limit) throw() { if (limit) limit->Retain(); _queue_limit = limit; }
+    bool IsOwnedBy(IKFAsyncGroupWorker_I* group) const throw() { return _owner == group; }
+
+    void SetAffinity(const int* cpus, int count) throw() //每次启动线程时生效
+    {
+        if (cpus == nullptr || count <= 0)
+            return;
+        _affinity_cpus = (int*)malloc(sizeof(int) * count);
+        if (_affinity_cpus == nullptr)
+            return;
+        memcpy(_affinity_cpus, cpus, sizeof(int) * count);
+        _affinity_cpu_count = count;
+    }
 
 public:
     virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
@@ -123,26 +472,20 @@ public:
     {
         KFLOG_T("%s -> TaskQueueStartup", "ThreadWorker");
 
-        if (_task_queue != nullptr || _task_notify_event != nullptr) {
+        if (_task_notify_event != nullptr) {
             KFLOG_ERROR_T("%s -> TaskQueueStartup: Re-entry.", "ThreadWorker");
             return KF_RE_ENTRY;
         }
 
-        //创建任务队列存储的 ArrayList 对象
-        if (KF_FAILED(KFCreateObjectArrayList(&_task_queue))) {
-            KFLOG_ERROR_T("%s -> TaskQueueStartup: KFCreateBaseObjectList Failed.", "ThreadWorker");
-            return KF_INVALID_OBJECT;
-        }
-
-        //创建通知执行或者退出线程的 Event 对象
-        _task_notify_event = KFEventCreate(0, 1);
+        //创建通知执行或者退出线程的 Event 对象（自动重置）
+        _task_notify_event = KFEventCreate(0, 0);
         if (_task_notify_event == nullptr) {
             KFLOG_ERROR_T("%s -> TaskQueueStartup: KFEventCreate Failed.", "ThreadWorker");
             return KF_INVALID_STATE;
         }
 
         //启动任务队列线程
-        if (!delayRunThread && !StartThread()) {
+        if (!delayRunThread && !WakeThread()) {
             KFLOG_ERROR_T("%s -> TaskQueueStartup: StartThread Failed.", "ThreadWorker");
             return KF_ERROR;
         }
@@ -153,20 +496,13 @@ public:
     {
         KFLOG_T("%s -> TaskQueueShutdown", "ThreadWorker");
 
-        //建立一个 WorkItem 对象，标记为 “请求退出” 模式
-        auto req = new(std::nothrow) WorkItem(IKFAsyncWorkItem_I::WorkItemState::RequestExit, nullptr);
-        if (req == nullptr)
-            return KF_OUT_OF_MEMORY;
-        
-        {
-            KFMutex::AutoLock lock(_mutex);
-            _task_queue->InsertElementAt(0, req); //插入到任务队列头，保证立即执行
+        //标记为请求退出，线程在取下一个任务之前就会退出，还没处理的任务被丢弃
+        _exit_requested.store(1);
+        int state = _thread_state.load();
+        if (state == ThreadParked && _thread_state.compare_exchange_strong(state, ThreadRunning))
             KFEventSet(_task_notify_event); //通知事件处理任务队列
 
-            KFLOG_T("%s -> TaskQueueShutdown: Notify event to exit.", "ThreadWorker");
-        }
-        
-        req->Recycle();
+        KFLOG_T("%s -> TaskQueueShutdown: Notify event to exit.", "ThreadWorker");
         return KF_OK;
     }
     
@@ -174,55 +510,109 @@ public:
     {
         KFLOG_T("%s -> PutItem (Level %d)", "ThreadWorker", int(level));
 
-        if (asyncItem == nullptr)
+        if (asyncItem == nullptr || level < 0 || level >= WorkItemLevelCount)
             return KF_INVALID_ARG;
-        
-        bool result = false;
-        KFMutex::AutoLock lock(_mutex);
-        int curTaskCount = _task_queue->GetElementCount();
-        KFLOG_T("%s -> PutItem (PendingTaskCount:%d)", "ThreadWorker", curTaskCount);
-
-        //优先级算法
-        if (level == WorkItemPriority::WorkItemLevel0) {
-            result = _task_queue->AddElement(asyncItem);
-        }else if (level == WorkItemLevel1) {
-            int pos = curTaskCount >> 1;
-            if (pos == 0)
-                result = _task_queue->AddElement(asyncItem);
-            else
-                result = _task_queue->InsertElementAt(pos - 1, asyncItem);
-        }else if (level == WorkItemLevel2) {
-            result = _task_queue->InsertElementAt(0, asyncItem);
-        }
+        if (_exit_requested.load(std::memory_order_relaxed))
+            return KF_SHUTDOWN;
 
-        //如果线程没有启动，启动线程
-        if (!_thread_running) {
-            if (!StartThread())
-                return KF_ABORT;
-        }
+        //插到对应优先级队列的尾部，先增加这个优先级的计数，再增加总数（消费者看到总数时一定能找到对应的优先级）
+        auto& band = _bands[level];
+        asyncItem->Retain();
+        band.Queue.Push(asyncItem->GetQueueNode());
+        band.Count.fetch_add(1);
+        _task_count.fetch_add(1);
+        _idle = 0; //马上标记为忙碌，线程组不会再把下一个任务当作空闲线程分配过来
+
+        //只有线程在等待（或者还没启动）的时候才需要通知
+        if (!WakeThread())
+            return KF_ABORT;
+        return KF_OK;
+    }
+    
+    virtual KF_RESULT PutItems(IKFAsyncWorkItem_I** asyncItems, int count, WorkItemPriority level)
+    {
+        KFLOG_T("%s -> PutItems (Level %d, Count %d)", "ThreadWorker", int(level), count);
 
-        //通知事件，处理任务队列
-        if (curTaskCount == 0)
-            KFEventSet(_task_notify_event);
+        if (asyncItems == nullptr || count <= 0 || level < 0 || level >= WorkItemLevelCount)
+            return KF_INVALID_ARG;
+        if (_exit_requested.load(std::memory_order_relaxed))
+            return KF_SHUTDOWN;
 
-        KFLOG_T("%s -> PutItem: Notify event to execute.", "ThreadWorker");
+        //先把这批任务的节点串起来，再一次性接到队列尾部
+        for (int i = 0; i < count; i++) {
+            asyncItems[i]->Retain();
+            if (i > 0)
+                asyncItems[i - 1]->GetQueueNode()->Next.store(asyncItems[i]->GetQueueNode(), std::memory_order_relaxed);
+        }
+        auto& band = _bands[level];
+        band.Queue.PushChain(asyncItems[0]->GetQueueNode(), asyncItems[count - 1]->GetQueueNode());
+        band.Count.fetch_add(count);
+        _task_count.fetch_add(count);
+        _idle = 0;
+
+        if (!WakeThread())
+            return KF_ABORT;
         return KF_OK;
     }
     
+    //只在本线程调用（Callback 里提交给本线程组的任务）：线程正在运行，入队以后不需要通知
+    //单线程的 Worker 放到自己的队列尾部保持 FIFO，work-stealing 的 Worker 放到 LIFO 槽，当前任务结束后马上执行
+    KF_RESULT PutLocalItem(IKFAsyncWorkItem_I* asyncItem, WorkItemPriority level)
+    {
+        if (_exit_requested.load(std::memory_order_relaxed) || _task_has_moved)
+            return KF_SHUTDOWN;
+        if (_group == nullptr)
+            return PutItem(asyncItem, level);
+        for (int i = level + 1; i < WorkItemLevelCount; i++)
+            if (_bands[i].Count.load(std::memory_order_relaxed) > 0)
+                return PutItem(asyncItem, level); //有更高优先级的任务在排队，不插队
+
+        asyncItem->Retain();
+        _idle = 0;
+        auto prev = _lifo_slot.exchange(asyncItem);
+        if (prev) {
+            //被挤出来的任务放到队列尾部，空闲的线程可以偷走
+            if (KF_FAILED(PutItem(prev, WorkItemPriority(prev->GetPriority()))))
+                DiscardItem(prev); //本线程正在退出
+            prev->Recycle();
+        }
+        return KF_OK;
+    }
+
     virtual int GetItemCount()
+    { return _task_count.load(std::memory_order_relaxed); }
+    virtual int GetLevelItemCount(WorkItemPriority level)
     {
-        if (_task_queue == nullptr)
+        if (level < 0 || level >= WorkItemLevelCount)
             return 0;
-        
-        KFMutex::AutoLock lock(_mutex);
-        return _task_queue->GetElementCount();
+        return _bands[level].Count.load(std::memory_order_relaxed);
     }
 
     virtual void SetTimeout(int timeout_ms) { _timeout_ms = timeout_ms; }
+    virtual void SetIdlePolicy(int idle_policy) { _idle_policy = idle_policy; }
+    virtual bool Prewarm()
+    {
+        if (_task_notify_event == nullptr)
+            return false;
+        return WakeThread(); //线程启动以后发现队列为空，会进入空闲等待
+    }
+    virtual void GetIdleStats(KFAsyncIdleStats* stats)
+    {
+        stats->SpinHits += _spin_hits.load(std::memory_order_relaxed);
+        stats->YieldHits += _yield_hits.load(std::memory_order_relaxed);
+        stats->ParkWakeups += _park_wakeups.load(std::memory_order_relaxed);
+    }
+    virtual void GetDropStats(KFAsyncDropStats* stats)
+    {
+        stats->Cancelled += _cancelled_drops.load(std::memory_order_relaxed);
+        stats->Expired += _expired_drops.load(std::memory_order_relaxed);
+        stats->Overflowed += _overflow_drops.load(std::memory_order_relaxed);
+    }
+    virtual void GetExecStats(KFAsyncWorkerStats* stats) { _exec_stats.AddTo(stats); }
 
     virtual int GetExecuteElapsedTime()
     {
-        auto time = _cur_task_exec_start_time;
+        auto time = _cur_task_exec_start_time.load(std::memory_order_relaxed);
         if (time < 0) return -1;
         return int(KFGetTick() - time);
     }
@@ -231,168 +621,495 @@ public:
     virtual void MoveCurrentTaskQueue(IKFAsyncThreadWorker_I* other)
     {
         if (other == nullptr) return;
-        KFMutex::AutoLock lock(_mutex);
-        int count = _task_queue->GetElementCount();
-        KFLOG_T("%s -> MoveCurrentTaskQueue: Count %d", "ThreadWorker", count);
-        if (count > 0) return;
-        if (other->AcceptTaskQueueMove(this, _task_queue)) {
-            _task_queue->RemoveAllElements();
+        if (!TryLockConsumer()) return;
+
+        IKFArrayList* queue = nullptr;
+        auto slot = _lifo_slot.exchange(nullptr); //LIFO 槽里的任务排在最前面，一起移走
+        if ((slot || _task_count.load() > 0) && KF_SUCCEEDED(KFCreateObjectArrayList(&queue))) {
+            if (slot)
+                queue->AddElement(slot);
+            KFAsyncQueueNode* node;
+            while ((node = PopNode()) != nullptr) {
+                queue->AddElement(node->Item);
+                node->Item->Recycle();
+            }
+        }
+        UnlockConsumer();
+        if (slot) {
+            if (queue == nullptr)
+                _lifo_slot.store(slot); //没有移走，还给自己
+            else
+                slot->Recycle();
+        }
+        if (queue == nullptr) return;
+
+        KFLOG_T("%s -> MoveCurrentTaskQueue: Count %d", "ThreadWorker", queue->GetElementCount());
+        if (other->AcceptTaskQueueMove(this, queue)) {
             _KF_LOCK_SWAP(&_task_has_moved, 1);
+        }else{
+            //对方拒绝，放回自己的队列
+            AcceptQueueItems(queue);
         }
+        queue->Recycle();
     }
     virtual bool AcceptTaskQueueMove(IKFAsyncThreadWorker_I* other, IKFArrayList* queue)
     {
         if (other == nullptr || queue == nullptr) return false;
-        KFMutex::AutoLock lock(_mutex);
         if (GetExecuteElapsedTime() >= other->GetExecuteElapsedTime()) return false;
-        int addCount = queue->GetElementCount();
-        KFLOG_T("%s -> AcceptTaskQueueMove: Count %d", "ThreadWorker", addCount);
-        for (int i = 0; i < addCount; i++) {
-            IKFBaseObject* task = nullptr;
-            queue->GetElementNoRef(i, &task);
-            if (task)
-                _task_queue->AddElement(task);
+        KFLOG_T("%s -> AcceptTaskQueueMove: Count %d", "ThreadWorker", queue->GetElementCount());
+        AcceptQueueItems(queue);
+        return true;
+    }
+
+    virtual bool IsIdle() { return _idle == 1; }
+    virtual int StealItems(IKFAsyncThreadWorker_I* thief)
+    {
+        if (thief == nullptr || thief == this) return 0;
+        //本线程正在取任务就放弃，不等待
+        if (!TryLockConsumer()) return 0;
+
+        //按照本线程的执行顺序偷走一半（至少一个）的任务
+        int count = _task_count.load();
+        int steal = _KF_MIN((count + 1) >> 1, WORKER_STEAL_MAX_COUNT);
+        KFAsyncQueueNode* stolen[WORKER_STEAL_MAX_COUNT];
+        int stolen_count = 0;
+        while (stolen_count < steal) {
+            auto node = PopNode();
+            if (node == nullptr)
+                break;
+            stolen[stolen_count++] = node;
+        }
+        UnlockConsumer();
+        KFLOG_T("%s -> StealItems: Count %d (Remain %d)", "ThreadWorker", stolen_count, count - stolen_count);
+
+        for (int i = 0; i < stolen_count; i++) {
+            auto item = stolen[i]->Item; //保持被偷任务的优先级和同一优先级内的相对顺序
+            if (KF_FAILED(thief->PutItem(item, WorkItemPriority(item->GetPriority()))))
+                DiscardItem(item); //偷任务的线程正在退出
+            item->Recycle();
+        }
+        return stolen_count;
+    }
+    virtual bool DropOldestItem()
+    {
+        //本线程正在取任务就放弃，由线程组换一个线程
+        if (!TryLockConsumer()) return false;
+        KFAsyncQueueNode* node = nullptr;
+        for (int i = 0; i < WorkItemLevelCount && node == nullptr; i++) {
+            int scan = _bands[i].Count.load();
+            while (scan-- > 0) {
+                node = _bands[i].Queue.Pop();
+                if (node == nullptr)
+                    break;
+                if (node->Item->IsOverflowExempt()) {
+                    //Strand 的 Drain 丢弃以后 Strand 再也不会执行，放回队列尾部，继续找下一个
+                    _bands[i].Queue.Push(node);
+                    node = nullptr;
+                    continue;
+                }
+                _bands[i].Count.fetch_sub(1);
+                _task_count.fetch_sub(1);
+                break;
+            }
         }
+        UnlockConsumer();
+        if (node == nullptr) return false;
+
+        _overflow_drops.fetch_add(1, std::memory_order_relaxed);
+        if (_queue_limit) _queue_limit->Release(1);
+        node->Item->Recycle();
         return true;
     }
 
 protected:
-    virtual bool StartThread()
+    bool StartThread()
     {
-        if (_thread_running)
-            return true;
-
-        if (!ThreadStart(nullptr, false, _name))
+        //线程的引用在启动之前增加（OnThreadExit 释放）：ThreadStart 返回以后 Worker 随时可能被销毁，线程那时可能还没有进入 OnThreadInvoke
+        Retain();
+        if (!ThreadStart(nullptr, false, _name)) {
+            Recycle();
+            _thread_state.store(ThreadStopped);
             return false;
-
-        _thread_running = true;
+        }
         return true;
     }
 
-    virtual void OnThreadInvoke(void*)
+    //生产者调用：线程在等待就通知事件，线程没有运行就启动线程，正在运行则什么都不做
+    bool WakeThread()
     {
-        KFLOG_T("%s -> OnThreadInvoke Begin...", "ThreadWorker");
-        Retain();
-        auto task = _task_queue; //任务队列对象
-        bool skipSyscall = false; //任务大于0的时候直接进入执行不调用KFEventWait
-        
+        int state = _thread_state.load();
         while (1) {
-            KFLOG_INFO_T("%s -> OnThreadInvoke: Event_WAIT...", "ThreadWorker");
-            bool waitTimeout = false; //是否等待超时（要退出）
-            //等待执行任务事件
-            if (!skipSyscall) {
-                if (_timeout_ms > 0) {
-                    waitTimeout = (KFEventWaitTimed(_task_notify_event, _timeout_ms) == KF_EVENT_TIME_OUT);
-                } else {
-                    KFEventWait(_task_notify_event);
-                }
-            }
-            skipSyscall = false;
-            KFLOG_INFO_T("%s -> OnThreadInvoke: %s ", "ThreadWorker", waitTimeout ? "Event_TIMEOUT." : "Event_ACCEPT!");
-
-            if (waitTimeout) {
-                KFMutex::AutoLock lock(_mutex);
-                if (task->GetElementCount() == 0) {
-                    _thread_running = false;
-                    break;
-                }else{
-                    continue;
+            if (state == ThreadRunning || state == ThreadExited)
+                return true;
+            if (_thread_state.compare_exchange_weak(state, ThreadRunning)) {
+                if (state == ThreadParked) {
+                    KFEventSet(_task_notify_event);
+                    return true;
                 }
+                return StartThread();
             }
+        }
+    }
 
-            IKFAsyncWorkItem_I* workItem = nullptr;
-            {
-                //弹出最开头的一个 WorkItem 对象
-                IKFBaseObject* object = nullptr;
-                KFMutex::AutoLock lock(_mutex);
-                if (task->RemoveElement(0, &object)) {
-                    KFBaseGetInterface(object, _INTERNAL_KF_INTERFACE_ID_ASYNC_WORK_ITEM, &workItem);
-                    object->Recycle();
-                }
-            }
-            
-            if (workItem == nullptr) {
-                KFLOG_WARN_T("%s -> OnThreadInvoke: WorkItem is Invalid.", "ThreadWorker");
-                KFMutex::AutoLock lock(_mutex);
-                KFEventReset(_task_notify_event); //失败就重设事件，重新等待
-                continue;
-            }
-            
-            auto command = workItem->GetItemState(); //取得 WorkItem 的类型
-            KFLOG_T("%s -> OnThreadInvoke: WorkItem type is [%s].", "ThreadWorker",
-                      (command == IKFAsyncWorkItem_I::WorkItemState::RequestExit ? "Exit" : "Task"));
+    bool TryLockConsumer()
+    {
+        int expect = 0;
+        return _consumer_lock.compare_exchange_strong(expect, 1, std::memory_order_acquire);
+    }
+    void LockConsumer()
+    {
+        while (!TryLockConsumer())
+            KFSwitchToThread(); //偷任务的线程只会持有很短的时间
+    }
+    void UnlockConsumer()
+    { _consumer_lock.store(0, std::memory_order_release); }
 
-            //如果是 “请求退出” 类型
-            if (command == IKFAsyncWorkItem_I::WorkItemState::RequestExit) {
-                KFLOG_T("%s -> OnThreadInvoke: Request exit.", "ThreadWorker");
-                KFMutex::AutoLock lock(_mutex);
-                workItem->Recycle();
-                task->RemoveAllElements(); //清空还没处理的任务队列
-                break; //跳出循环体，退出线程
-            }
-            
-            IKFAsyncResult_I* result = nullptr;
-            if (!workItem->GetAsyncResult(&result) || result == nullptr) {
-                KFLOG_WARN_T("%s -> OnThreadInvoke: AsyncResult is Empty.", "ThreadWorker");
-                workItem->Recycle();
+    //选择下一个要执行的优先级：最高的非空优先级，除非有低优先级已经被插队太多次（aging）
+    //必须持有消费者身份
+    int SelectBand()
+    {
+        int top = -1, aged = -1;
+        for (int i = WorkItemLevelCount - 1; i >= 0; i--) {
+            if (_bands[i].Count.load() == 0)
                 continue;
-            }
-            
-            IKFAsyncCallback* callback = nullptr;
-            result->GetCallback(&callback); //取得 Callback 对象
+            if (top == -1)
+                top = i;
+            else if (aged == -1 && _bands[i].Skipped >= WORKER_PRIORITY_AGING_LIMIT)
+                aged = i;
+        }
+        int selected = aged != -1 ? aged : top;
+        if (selected == -1)
+            return -1;
+
+        //除了被选中的优先级，其他有任务的优先级都算作被插队一次
+        for (int i = 0; i < WorkItemLevelCount; i++) {
+            if (i == selected)
+                _bands[i].Skipped = 0;
+            else if (_bands[i].Count.load(std::memory_order_relaxed) > 0)
+                _bands[i].Skipped++;
+        }
+        return selected;
+    }
 
-            KFLOG_T("%s -> OnThreadInvoke: Execute callback...", "ThreadWorker");
-            _cur_task_exec_start_time = KFGetTick();
-            callback->Execute(result); //执行 Callback！
-            _cur_task_exec_start_time = -1;
-            KFLOG_T("%s -> OnThreadInvoke: Execute callback finished.", "ThreadWorker");
-            
-            callback->Recycle();
-            result->Recycle();
-            
-            {
-                KFMutex::AutoLock lock(_mutex);
-                int pendingTaskCount = task->GetElementCount();
-                if (pendingTaskCount == 0) {
-                    //如果任务队列已经处理完成了，就重新等待事件，不然则重新循环处理任务
-                    KFEventReset(_task_notify_event);
-                    KFLOG_INFO_T("%s -> OnThreadInvoke: Event_RESET.", "ThreadWorker");
-                    if (_task_has_moved) {
-                        //如果任务已经被移走，直接退出线程
-                        break;
-                    }
-                } else {
-                    //如果当前的任务队列不为空，则不需要执行等待Event
-                    skipSyscall = true;
-                    KFLOG_INFO_T("%s -> OnThreadInvoke: Process Next... Pending: %d", "ThreadWorker", pendingTaskCount);
+    //必须持有消费者身份
+    KFAsyncQueueNode* PopNode()
+    {
+        while (_task_count.load() > 0) {
+            int level = SelectBand();
+            if (level != -1) {
+                auto node = _bands[level].Queue.Pop();
+                if (node) {
+                    _bands[level].Count.fetch_sub(1);
+                    _task_count.fetch_sub(1);
+                    return node;
                 }
             }
+            KFSwitchToThread(); //生产者正在入队的中途
+        }
+        return nullptr;
+    }
 
-            workItem->Recycle();
+    void AcceptQueueItems(IKFArrayList* queue)
+    {
+        int addCount = queue->GetElementCount();
+        for (int i = 0; i < addCount; i++) {
+            IKFBaseObject* task = nullptr;
+            queue->GetElementNoRef(i, &task);
+            if (task) {
+                auto item = static_cast<IKFAsyncWorkItem_I*>(task);
+                if (KF_FAILED(PutItem(item, WorkItemPriority(item->GetPriority()))))
+                    DiscardItem(item); //本线程正在退出
+            }
         }
-        KFLOG_T("%s -> OnThreadInvoke Ended.", "ThreadWorker");
     }
 
-    virtual int OnThreadExit() { Recycle(); return 0; }
-};
+    void DropAllItems()
+    {
+        int dropped = 0;
+        auto slot = _lifo_slot.exchange(nullptr);
+        if (slot) {
+            slot->OnDiscarded();
+            slot->Recycle();
+            dropped++;
+        }
 
-// ***************
+        //先在消费者身份下取出所有任务（用节点的 Next 串起来），OnDiscarded 可能执行任意的代码，放到锁外
+        KFAsyncQueueNode* chain = nullptr;
+        LockConsumer();
+        KFAsyncQueueNode* node;
+        while ((node = PopNode()) != nullptr) {
+            node->Next.store(chain, std::memory_order_relaxed);
+            chain = node;
+            dropped++;
+        }
+        UnlockConsumer();
+        while (chain) {
+            node = chain;
+            chain = node->Next.load(std::memory_order_relaxed);
+            node->Item->OnDiscarded();
+            node->Item->Recycle();
+        }
+        if (dropped > 0 && _queue_limit)
+            _queue_limit->Release(dropped); //等待名额的生产者会拿到名额，然后发现 Worker 已经关闭
+    }
 
-class GroupWorker : public IKFAsyncGroupWorker_I
-{
-    KF_IMPL_DECL_REFCOUNT;
-    
-    int _max_threads;
+    //任务没有进入任何队列就被丢弃：通知提交者，并归还排队的名额
+    void DiscardItem(IKFAsyncWorkItem_I* item)
+    {
+        item->OnDiscarded();
+        if (_queue_limit)
+            _queue_limit->Release(1);
+    }
+
+    //按照等待策略先自旋、让出线程，在这期间有新任务（或者退出请求）就返回 true，不需要进入等待
+    //线程状态保持 Running，生产者不会去通知事件
+    bool SpinBeforePark()
+    {
+        if (_idle_policy == KF_ASYNC_IDLE_SPIN_YIELD_PARK && kSystemCpuCount > 1) { //单核上自旋没有意义
+            for (int i = 0; i < WORKER_IDLE_SPIN_COUNT; i++) {
+                if (_task_count.load(std::memory_order_relaxed) > 0 || _exit_requested.load(std::memory_order_relaxed)) {
+                    _spin_hits.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                KFCpuRelax();
+            }
+        }
+        if (_idle_policy == KF_ASYNC_IDLE_YIELD_PARK || _idle_policy == KF_ASYNC_IDLE_SPIN_YIELD_PARK) {
+            for (int i = 0; i < WORKER_IDLE_YIELD_COUNT; i++) {
+                if (_task_count.load(std::memory_order_relaxed) > 0 || _exit_requested.load(std::memory_order_relaxed)) {
+                    _yield_hits.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                KFSwitchToThread();
+            }
+        }
+        return false;
+    }
+
+    //在等待之前调用：返回 true 表示可以进入等待，false 表示已经有新任务
+    bool ParkThread()
+    {
+        _thread_state.store(ThreadParked);
+        if (_task_count.load() == 0 && !_exit_requested.load())
+            return true;
+        int state = ThreadParked;
+        if (_thread_state.compare_exchange_strong(state, ThreadRunning))
+            return false;
+        return true; //生产者已经接手并通知了事件，等待会立即返回
+    }
+
+    //线程准备退出：返回 false 表示有新任务到达，线程需要继续运行
+    bool StopThread(int from_state)
+    {
+        int state = from_state;
+        if (!_thread_state.compare_exchange_strong(state, ThreadStopped))
+            return false; //生产者已经接手
+        if (_task_count.load() == 0)
+            return true;
+        state = ThreadStopped;
+        return !_thread_state.compare_exchange_strong(state, ThreadRunning);
+    }
+
+    virtual void OnThreadInvoke(void*)
+    {
+        KFLOG_T("%s -> OnThreadInvoke Begin...", "ThreadWorker");
+        kCurrentThreadWorker = this;
+        if (_affinity_cpus && !KFThreadSetAffinity(nullptr, _affinity_cpus, _affinity_cpu_count))
+            KFLOG_WARN_T("%s -> OnThreadInvoke: KFThreadSetAffinity Failed.", "ThreadWorker");
+        
+        while (1) {
+            if (_exit_requested.load()) {
+                KFLOG_T("%s -> OnThreadInvoke: Request exit.", "ThreadWorker");
+                _thread_state.store(ThreadExited);
+                DropAllItems(); //清空还没处理的任务队列
+                break; //跳出循环体，退出线程
+            }
+
+            //每次只取一个任务：新到达的高优先级任务可以马上插队，剩下的任务别的线程也随时可以偷走
+            auto node = TakeLifoSlot();
+            if (node == nullptr) {
+                LockConsumer();
+                node = PopNode();
+                UnlockConsumer();
+            }
+
+            if (node == nullptr) {
+                _idle = 1;
+                if (_task_has_moved) {
+                    //任务已经被 watchdog 移走，这个线程已经不属于线程组，直接退出线程（不再去偷任务）
+                    if (StopThread(ThreadRunning))
+                        break;
+                    continue;
+                }
+                //任务队列空了，在等待之前先去帮忙执行别的线程积压的任务
+                if (TryStealWorkItems())
+                    continue;
+                if (SpinBeforePark() || !ParkThread())
+                    continue;
+
+                KFLOG_INFO_T("%s -> OnThreadInvoke: Event_WAIT...", "ThreadWorker");
+                //等待执行任务事件
+                if (_timeout_ms > 0) {
+                    if (KFEventWaitTimed(_task_notify_event, _timeout_ms) == KF_EVENT_TIME_OUT) {
+                        KFLOG_INFO_T("%s -> OnThreadInvoke: %s ", "ThreadWorker", "Event_TIMEOUT.");
+                        if (StopThread(ThreadParked))
+                            break;
+                        continue;
+                    }
+                } else {
+                    KFEventWait(_task_notify_event);
+                }
+                _park_wakeups.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            IKFAsyncWorkItem_I* workItem = node->Item;
+            if (_queue_limit)
+                _queue_limit->Release(1); //任务离开队列，归还排队的名额
+            auto drop = workItem->CheckDrop();
+            if (drop != IKFAsyncWorkItem_I::DropReason::NotDropped) {
+                //已经取消或者超过期限，不执行 Callback，只计数
+                if (drop == IKFAsyncWorkItem_I::DropReason::DropCancelled)
+                    _cancelled_drops.fetch_add(1, std::memory_order_relaxed);
+                else
+                    _expired_drops.fetch_add(1, std::memory_order_relaxed);
+                workItem->OnDiscarded();
+                workItem->Recycle();
+                continue;
+            }
+
+            auto command = workItem->GetItemState(); //取得 WorkItem 的类型
+            if (command == IKFAsyncWorkItem_I::WorkItemState::ExecuteFunction) {
+                auto start_us = KFAsyncNowUs();
+                _cur_task_exec_start_time.store(KFGetTick(), std::memory_order_relaxed);
+                workItem->InvokeFunction(); //执行函数（协程恢复等不需要 Callback 对象的任务）
+                _cur_task_exec_start_time.store(-1, std::memory_order_relaxed);
+                _exec_stats.OnExecuted(start_us - workItem->GetEnqueueTime(), KFAsyncNowUs() - start_us);
+                workItem->Recycle();
+                continue;
+            }
+
+            //WorkItem 持有 Result，执行期间不需要再增加 Result 的引用计数
+            auto result = command == IKFAsyncWorkItem_I::WorkItemState::ExecuteTask ? workItem->PeekAsyncResult() : nullptr;
+            if (result == nullptr) {
+                KFLOG_WARN_T("%s -> OnThreadInvoke: AsyncResult is Empty.", "ThreadWorker");
+                workItem->Recycle();
+                continue;
+            }
+
+            IKFAsyncCallback* callback = nullptr;
+            result->GetCallback(&callback); //取得 Callback 对象（持有引用，执行期间可能被 SetCallback 替换）
+
+            KFLOG_T("%s -> OnThreadInvoke: Execute callback...", "ThreadWorker");
+            auto start_us = KFAsyncNowUs();
+            _cur_task_exec_start_time.store(KFGetTick(), std::memory_order_relaxed);
+            callback->Execute(result); //执行 Callback！
+            _cur_task_exec_start_time.store(-1, std::memory_order_relaxed);
+            _exec_stats.OnExecuted(start_us - workItem->GetEnqueueTime(), KFAsyncNowUs() - start_us);
+            KFLOG_T("%s -> OnThreadInvoke: Execute callback finished.", "ThreadWorker");
+
+            callback->Recycle();
+            workItem->Recycle();
+        }
+        kCurrentThreadWorker = nullptr;
+        KFLOG_T("%s -> OnThreadInvoke Ended.", "ThreadWorker");
+    }
+
+    virtual int OnThreadExit() { Recycle(); return 0; }
+
+private:
+    //LIFO 槽里的任务先执行，连续执行太多次并且队列里有任务，就把它放到队列尾部（一直提交后续任务的链不会饿死别的任务）
+    KFAsyncQueueNode* TakeLifoSlot()
+    {
+        IKFAsyncWorkItem_I* item = nullptr;
+        if (_lifo_slot.load(std::memory_order_relaxed) != nullptr)
+            item = _lifo_slot.exchange(nullptr);
+        if (item == nullptr) {
+            _lifo_runs = 0;
+            return nullptr;
+        }
+        if (++_lifo_runs > WORKER_LIFO_SLOT_LIMIT && _task_count.load() > 0) {
+            _lifo_runs = 0;
+            PutItem(item, WorkItemPriority(item->GetPriority()));
+            item->Recycle();
+            return nullptr;
+        }
+        return item->GetQueueNode();
+    }
+
+    bool TryStealWorkItems()
+    {
+        //偷到的任务会通过 PutItem 进入自己的队列
+        if (_group && _group->StealWorkItems(this)) {
+            KFLOG_INFO_T("%s -> OnThreadInvoke: Stole work items.", "ThreadWorker");
+            return true;
+        }
+        return false;
+    }
+};
+
+// ***************
+
+class GroupWorker;
+static void KFWatchdogRegister(GroupWorker* group);
+static void KFWatchdogUnregister(GroupWorker* group);
+
+class GroupWorker : public IKFAsyncGroupWorker_I
+{
+    KF_IMPL_DECL_REFCOUNT;
+    
+    int _max_threads;
     IKFArrayList* _threads;
+    bool _work_stealing; //多线程的线程组开启 work-stealing，空闲线程会去偷别的线程的任务
+    int _next_thread; //线程饱和时轮流提交的线程索引
+    int _idle_policy; //每个 ThreadWorker 的空闲等待策略
+    int _min_threads; //常驻的线程数（空闲时不退出）
+    int _keep_alive_ms; //其他线程空闲多久后退出
+    
+    int _affinity_mode; //KF_ASYNC_AFFINITY_*
+    int* _affinity_cpus;
+    int _affinity_cpu_count;
+    int _numa_nodes; //KF_ASYNC_AFFINITY_SPREAD_NUMA 时的节点数
     
+    int _stall_timeout_ms; //阻塞检测的时间（0 表示不检测）
+    IKFArrayList* _stalled_threads; //被移出线程组、还在执行阻塞任务的线程（溢出线程数）
+    KFAsyncWorkerStats _retired_stats; //已经离开线程组的线程的执行统计
+
+    WorkerQueueLimit* _queue_limit; //排队的任务数上限（不限制为 nullptr）
+    int _overflow_policy; //KF_ASYNC_OVERFLOW_*
+    int _overflow_timeout_ms;
+    std::atomic<KF_INT64> _cancelled_drops, _expired_drops; //KF_ASYNC_OVERFLOW_CALLER_RUNS 在提交线程上丢弃的任务数
+    
+    //work-stealing 的线程快照（持有每个线程的引用），空闲线程偷任务时不加 _mutex 读取
+    //修改 _threads 以后在锁里重新发布，旧快照等 _steal_readers 变成 0 再释放
+    struct StealSnapshot
+    {
+        int Count;
+        IKFAsyncThreadWorker_I* Threads[1];
+    };
+    std::atomic<StealSnapshot*> _steal_snapshot;
+    std::atomic<int> _steal_readers;
+
     KFMutex _mutex;
     bool _shutdown;
     char* _name;
 
 public:
-    GroupWorker() throw() : _ref_count(1), _max_threads(0), _threads(nullptr), _shutdown(true), _name(nullptr) {}
+    GroupWorker() throw() : _ref_count(1), _max_threads(0), _threads(nullptr), _work_stealing(false), _next_thread(0), _idle_policy(KF_ASYNC_IDLE_PARK), _min_threads(0), _keep_alive_ms(WORKER_EXIT_TIMEOUT),
+        _affinity_mode(KF_ASYNC_AFFINITY_NONE), _affinity_cpus(nullptr), _affinity_cpu_count(0), _numa_nodes(1),
+        _stall_timeout_ms(0), _stalled_threads(nullptr),
+        _queue_limit(nullptr), _overflow_policy(KF_ASYNC_OVERFLOW_REJECT), _overflow_timeout_ms(0), _cancelled_drops(0), _expired_drops(0),
+        _steal_snapshot(nullptr), _steal_readers(0), _shutdown(true), _name(nullptr)
+    { memset(&_retired_stats, 0, sizeof(_retired_stats)); }
     virtual ~GroupWorker() throw()
-    { if (_threads) _threads->Recycle(); if (_name) free(_name); }
+    {
+        FreeStealSnapshot(_steal_snapshot.exchange(nullptr));
+        if (_threads) _threads->Recycle();
+        if (_stalled_threads) _stalled_threads->Recycle();
+        if (_queue_limit) _queue_limit->Recycle();
+        if (_affinity_cpus) free(_affinity_cpus);
+        if (_name) free(_name);
+    }
     
 public:
     virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
@@ -413,13 +1130,42 @@ public:
     { KF_IMPL_RECYCLE_FUNC(_ref_count); }
     
 public:
-    virtual KF_RESULT Startup(int max_threads, const char* name)
+    virtual KF_RESULT Startup(const KFAsyncWorkerConfig* config)
     {
         KFLOG_T("%s -> Startup", "GroupWorker");
 
+        if (config == nullptr)
+            return KF_INVALID_PTR;
+        if (config->IdlePolicy < KF_ASYNC_IDLE_PARK || config->IdlePolicy > KF_ASYNC_IDLE_SPIN_YIELD_PARK ||
+            config->MinThreads < 0 || config->KeepAliveMs < KF_ASYNC_KEEP_ALIVE_INFINITE ||
+            config->StallTimeoutMs < KF_ASYNC_STALL_TIMEOUT_DISABLED ||
+            config->QueueCapacity < 0 || config->OverflowPolicy < KF_ASYNC_OVERFLOW_REJECT || config->OverflowPolicy > KF_ASYNC_OVERFLOW_CALLER_RUNS ||
+            config->AffinityMode < KF_ASYNC_AFFINITY_NONE || config->AffinityMode > KF_ASYNC_AFFINITY_SPREAD_NUMA)
+            return KF_INVALID_ARG;
+        if (config->AffinityMode == KF_ASYNC_AFFINITY_CPU_SET && (config->AffinityCpus == nullptr || config->AffinityCpuCount <= 0))
+            return KF_INVALID_ARG;
+
         KFMutex::AutoLock lock(_mutex);
-        if (name)
-            _name = strdup(name);
+        _idle_policy = config->IdlePolicy;
+        if (config->KeepAliveMs == KF_ASYNC_KEEP_ALIVE_DEFAULT)
+            _keep_alive_ms = WORKER_EXIT_TIMEOUT;
+        else if (config->KeepAliveMs == KF_ASYNC_KEEP_ALIVE_INFINITE)
+            _keep_alive_ms = 0; //ThreadWorker 没有超时就一直等待
+        else
+            _keep_alive_ms = config->KeepAliveMs;
+        if (config->Name)
+            _name = strdup(config->Name);
+        if (KF_FAILED(SetupAffinity(config)))
+            return KF_OUT_OF_MEMORY;
+
+        //排队容量在创建线程之前设置，每个 ThreadWorker 都要引用
+        if (config->QueueCapacity != KF_ASYNC_QUEUE_CAPACITY_UNLIMITED && _queue_limit == nullptr) {
+            _queue_limit = new(std::nothrow) WorkerQueueLimit(config->QueueCapacity);
+            if (_queue_limit == nullptr || !_queue_limit->IsValid())
+                return KF_OUT_OF_MEMORY;
+            _overflow_policy = config->OverflowPolicy;
+            _overflow_timeout_ms = config->OverflowBlockTimeoutMs;
+        }
 
         if (_threads == nullptr) {
             //创建线程集合存储对象，存储所有的 ThreadWorker 对象
@@ -435,32 +1181,54 @@ public:
         }
         
         //尝试取得系统的 CPU 核心数，用于自动决定最大线程
-        _max_threads = max_threads;
+        _max_threads = config->Parallel ? config->MaxThreads : 1;
         if (_max_threads != KF_ASYNC_WORKER_THREADS_INFINITE) {
-            if (_max_threads <= 0)
+            if (_max_threads <= 0 && _affinity_cpu_count > 0)
+                _max_threads = _affinity_cpu_count; //每个线程一个核心
+            else if (_max_threads <= 0)
                 _max_threads = KFSystemCpuCount() + 1;
             if (_max_threads == 0)
                 _max_threads = 1;
         }
+        //单线程的 Worker 保持严格的 FIFO，不参与 work-stealing
+        _work_stealing = (_max_threads != 1);
 
-        KFLOG_T("%s -> Startup: Max Threads is %d.", "GroupWorker", _max_threads);
-        
-        auto thread = CreateThreadWorker(MakeThreadWorkerName(0)); //创建第一个 ThreadWorker 对象
-        if (thread == nullptr) {
-            KFLOG_ERROR_T("%s -> Startup: CreateThreadWorker Failed.", "GroupWorker");
-            return KF_INVALID_OBJECT;
-        }
+        _min_threads = config->MinThreads;
+        if (_max_threads != KF_ASYNC_WORKER_THREADS_INFINITE && _min_threads > _max_threads)
+            _min_threads = _max_threads;
+
+        KFLOG_T("%s -> Startup: Max Threads is %d, Min Threads is %d. (Work-stealing: %s)", "GroupWorker",
+                _max_threads, _min_threads, _work_stealing ? "true" : "false");
         
-        //启动这个 ThreadWorker 的实例线程体
-        thread->SetTimeout(WORKER_EXIT_TIMEOUT);
-        if (KF_FAILED(thread->TaskQueueStartup(true)) || !_threads->AddElement(thread)) {
-            KFLOG_ERROR_T("%s -> Startup: TaskQueueStartup(Thread) Failed.", "GroupWorker");
+        //没有常驻线程的时候，第一个 ThreadWorker 延迟到提交任务时才启动线程
+        int count = _KF_MAX(_min_threads, 1);
+        for (int i = 0; i < count; i++) {
+            auto thread = CreateThreadWorker(i);
+            if (thread == nullptr) {
+                KFLOG_ERROR_T("%s -> Startup: CreateThreadWorker Failed.", "GroupWorker");
+                return KF_INVALID_OBJECT;
+            }
+
+            //启动这个 ThreadWorker 的实例线程体
+            if (KF_FAILED(thread->TaskQueueStartup(_min_threads == 0)) || !_threads->AddElement(thread)) {
+                KFLOG_ERROR_T("%s -> Startup: TaskQueueStartup(Thread) Failed.", "GroupWorker");
+                thread->TaskQueueShutdown();
+                thread->Recycle();
+                return KF_ERROR;
+            }
             thread->Recycle();
-            return KF_ERROR;
         }
-        thread->Recycle();
+
+        //单线程的 Worker 要保证任务互斥执行，不做迁移
+        if (_work_stealing && config->StallTimeoutMs != KF_ASYNC_STALL_TIMEOUT_DISABLED) {
+            if (_stalled_threads == nullptr && KF_FAILED(KFCreateObjectArrayList(&_stalled_threads)))
+                return KF_INVALID_OBJECT;
+            _stall_timeout_ms = config->StallTimeoutMs == KF_ASYNC_STALL_TIMEOUT_DEFAULT ? WORKER_STALL_TIMEOUT : config->StallTimeoutMs;
+            KFWatchdogRegister(this);
+        }
 
         _shutdown = false;
+        PublishStealSnapshot();
         return KF_OK;
     }
     
@@ -469,6 +1237,8 @@ public:
         KFLOG_T("%s -> Shutdown", "GroupWorker");
 
         KFMutex::AutoLock lock(_mutex);
+        if (_threads == nullptr)
+            return KF_OK;
         int count = _threads->GetElementCount();
         KFLOG_T("%s -> Shutdown: Current Threads is %d.", "GroupWorker", count);
 
@@ -486,21 +1256,33 @@ public:
         }
         //移除所有 ThreadWorker 对象
         _threads->RemoveAllElements();
+        PublishStealSnapshot();
+
+        if (_stalled_threads) {
+            KFWatchdogUnregister(this);
+            count = _stalled_threads->GetElementCount();
+            for (int i = 0; i < count; i++) {
+                IKFBaseObject* obj = nullptr;
+                _stalled_threads->GetElementNoRef(i, &obj);
+                if (obj)
+                    static_cast<IKFAsyncThreadWorker_I*>(obj)->TaskQueueShutdown();
+            }
+            _stalled_threads->RemoveAllElements();
+        }
 
         _shutdown = true;
         return KF_OK;
     }
     
-    virtual KF_RESULT PutWorkItem(IKFAsyncResult* result, bool realtime)
+    virtual KF_RESULT PutWorkItem(IKFAsyncResult* result, const KFAsyncWorkItemOptions* options)
     {
-        KFLOG_T("%s -> PutWorkItem (Real-time: %s)", "GroupWorker", realtime ? "true" : "false");
+        if (result == nullptr || options == nullptr)
+            return KF_INVALID_ARG;
 
-        if (result == nullptr)
+        int priority = options->Priority;
+        KFLOG_T("%s -> PutWorkItem (Priority %d)", "GroupWorker", priority);
+        if (priority < 0 || priority >= IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevelCount)
             return KF_INVALID_ARG;
-        
-        KFMutex::AutoLock lock(_mutex);
-        if (_shutdown)
-            return KF_SHUTDOWN;
 
         IKFAsyncResult_I* callback = nullptr;
         KFBaseGetInterface(result, _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT, &callback);
@@ -510,169 +1292,1254 @@ public:
         }
         
         //新建立一个 WorkItem 对象，标记为 “执行任务” 模式
-        auto workItem = new(std::nothrow) WorkItem(IKFAsyncWorkItem_I::WorkItemState::ExecuteTask, callback);
+        auto workItem = new(std::nothrow) WorkItem(IKFAsyncWorkItem_I::WorkItemState::ExecuteTask, callback, priority);
         if (workItem == nullptr) {
             KFLOG_ERROR_T("%s -> PutWorkItem: Alloc Memory Failed.", "GroupWorker");
             callback->Recycle();
             return KF_OUT_OF_MEMORY;
         }
         callback->Recycle();
+        workItem->SetDropCondition(options->CancelToken, options->DeadlineMs);
 
-        //提交这个 WorkItem 去某个 ThreadWorker 执行
-        auto r = InternalPutWorkItem(workItem,
-                                     realtime ?
-                                     IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevel2 :
-                                     IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevel0);
-        if (KF_FAILED(r)) {
-            KFLOG_ERROR_T("%s -> PutWorkItem: InternalPutWorkItem Failed.", "GroupWorker");
-            workItem->Recycle();
-            return r;
+        auto r = SubmitWorkItem(workItem, IKFAsyncThreadWorker_I::WorkItemPriority(priority));
+        if (KF_FAILED(r))
+            KFLOG_ERROR_T("%s -> PutWorkItem: SubmitWorkItem Failed.", "GroupWorker");
+        workItem->Recycle();
+        return r;
+    }
+    
+    virtual KF_RESULT PutWorkFunction(KFAsyncWorkFunc func, void* context, int priority)
+    {
+        if (func == nullptr ||
+            priority < 0 || priority >= IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevelCount)
+            return KF_INVALID_ARG;
+
+        //WorkItem 从内存池分配，整个提交过程没有别的分配
+        auto workItem = new(std::nothrow) WorkItem(func, context, priority);
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutWorkFunction: Alloc Memory Failed.", "GroupWorker");
+            return KF_OUT_OF_MEMORY;
         }
-        
+
+        auto r = SubmitWorkItem(workItem, IKFAsyncThreadWorker_I::WorkItemPriority(priority));
         workItem->Recycle();
-        return KF_OK;
+        return r;
+    }
+
+    virtual KF_RESULT PutInlineFunction(const KFAsyncInlineFuncOps* ops, void* source, int priority)
+    {
+        if (ops == nullptr ||
+            priority < 0 || priority >= IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevelCount)
+            return KF_INVALID_ARG;
+
+        auto workItem = WorkItem::CreateInline(ops, source, priority);
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutInlineFunction: Construct Failed.", "GroupWorker");
+            return KF_OUT_OF_MEMORY;
+        }
+
+        auto r = SubmitWorkItem(workItem, IKFAsyncThreadWorker_I::WorkItemPriority(priority));
+        workItem->Recycle();
+        return r;
+    }
+
+    virtual KF_RESULT PutDrainFunction(KFAsyncWorkFunc func, KFAsyncWorkFunc discard, void* context, int priority)
+    {
+        if (func == nullptr ||
+            priority < 0 || priority >= IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevelCount)
+            return KF_INVALID_ARG;
+
+        auto workItem = new(std::nothrow) WorkItem(func, context, priority);
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutDrainFunction: Alloc Memory Failed.", "GroupWorker");
+            return KF_OUT_OF_MEMORY;
+        }
+        workItem->SetDiscardHandler(discard);
+
+        //Drain 重新排队是为了把线程让给别的任务：LIFO 槽会让它马上再执行，CALLER_RUNS 会在 Drain 里递归执行
+        //所以 CALLER_RUNS 时也占用名额入队，并且总是通过线程组放到某个线程的队列尾部
+        bool caller_runs = false;
+        auto r = AcquireQueueSlots(1, &caller_runs);
+        if (KF_SUCCEEDED(r)) {
+            if (caller_runs)
+                _queue_limit->ForceAcquire(1);
+            KFMutex::AutoLock lock(_mutex);
+            r = _shutdown ? KF_SHUTDOWN : InternalPutWorkItem(workItem, IKFAsyncThreadWorker_I::WorkItemPriority(priority));
+            if (KF_FAILED(r))
+                ReleaseQueueSlots(1);
+        }
+        workItem->Recycle();
+        return r;
+    }
+    
+    virtual KF_RESULT PutWorkItems(IKFAsyncResult** results, int count, int priority)
+    {
+        KFLOG_T("%s -> PutWorkItems (Priority %d, Count %d)", "GroupWorker", priority, count);
+
+        if (results == nullptr || count <= 0 ||
+            priority < 0 || priority >= IKFAsyncThreadWorker_I::WorkItemPriority::WorkItemLevelCount)
+            return KF_INVALID_ARG;
+
+        auto workItems = (IKFAsyncWorkItem_I**)malloc(sizeof(IKFAsyncWorkItem_I*) * count);
+        if (workItems == nullptr)
+            return KF_OUT_OF_MEMORY;
+
+        //先在锁外创建所有 WorkItem 对象
+        KF_RESULT r = KF_OK;
+        int created = 0;
+        for (; created < count; created++) {
+            IKFAsyncResult_I* callback = nullptr;
+            if (results[created])
+                KFBaseGetInterface(results[created], _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT, &callback);
+            if (callback == nullptr) {
+                KFLOG_ERROR_T("%s -> PutWorkItems: Callback %d is Invalid.", "GroupWorker", created);
+                r = KF_NO_INTERFACE;
+                break;
+            }
+            workItems[created] = new(std::nothrow) WorkItem(IKFAsyncWorkItem_I::WorkItemState::ExecuteTask, callback, priority);
+            callback->Recycle();
+            if (workItems[created] == nullptr) {
+                KFLOG_ERROR_T("%s -> PutWorkItems: Alloc Memory Failed.", "GroupWorker");
+                r = KF_OUT_OF_MEMORY;
+                break;
+            }
+        }
+
+        bool caller_runs = false;
+        if (KF_SUCCEEDED(r))
+            r = AcquireQueueSlots(count, &caller_runs);
+        if (KF_SUCCEEDED(r)) {
+            if (caller_runs) {
+                for (int i = 0; i < count; i++)
+                    RunOnCaller(workItems[i]);
+            }else{
+                r = InternalPutWorkItems(workItems, count, IKFAsyncThreadWorker_I::WorkItemPriority(priority));
+                if (KF_FAILED(r))
+                    ReleaseQueueSlots(count); //只会在线程组关闭时失败
+            }
+        }
+
+        for (int i = 0; i < created; i++)
+            workItems[i]->Recycle();
+        free(workItems);
+        return r;
     }
     
+    virtual int GetMaxThreads()
+    {
+        if (_max_threads == KF_ASYNC_WORKER_THREADS_INFINITE)
+            return KFSystemCpuCount();
+        return _max_threads;
+    }
+
     virtual int GetCurrentThreads()
     {
         KFMutex::AutoLock lock(_mutex);
         return _threads->GetElementCount();
     }
-    
-private:
-    char* MakeThreadWorkerName(int index)
+
+    virtual KF_RESULT Prewarm(int threads)
     {
-        if (_name == nullptr)
-            return nullptr;
+        KFLOG_T("%s -> Prewarm (Threads %d)", "GroupWorker", threads);
 
-        auto c = (char*)malloc(strlen(_name) + 128);
-        if (c)
-            sprintf(c, "%s : Worker %d", _name, index);
-        return c;
+        KFMutex::AutoLock lock(_mutex);
+        if (_shutdown)
+            return KF_SHUTDOWN;
+        if (_max_threads != KF_ASYNC_WORKER_THREADS_INFINITE)
+            threads = _KF_MIN(threads, _max_threads);
+
+        //先启动已经创建的线程（延迟启动的或者空闲退出的），不够的再创建
+        int count = _threads->GetElementCount();
+        for (int i = 0; i < threads; i++) {
+            if (i < count) {
+                IKFAsyncThreadWorker_I* thread = nullptr;
+                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                              _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                              &thread);
+                if (thread) {
+                    thread->Prewarm();
+                    thread->Recycle();
+                }
+                continue;
+            }
+
+            auto newThread = CreateThreadWorker(i);
+            if (newThread == nullptr)
+                return KF_OUT_OF_MEMORY;
+            if (KF_FAILED(newThread->TaskQueueStartup(false)) || !_threads->AddElement(newThread)) {
+                KFLOG_ERROR_T("%s -> Prewarm: TaskQueueStartup Failed.", "GroupWorker");
+                newThread->TaskQueueShutdown();
+                newThread->Recycle();
+                PublishStealSnapshot();
+                return KF_INVALID_STATE;
+            }
+            newThread->Recycle();
+            PublishStealSnapshot();
+        }
+        return KF_OK;
     }
 
-    ThreadWorker* CreateThreadWorker(char* name)
+    virtual void GetIdleStats(KFAsyncIdleStats* stats)
     {
-        auto t = new(std::nothrow) ThreadWorker(name);
-        if (name)
-            free(name); //MakeThreadWorkerName
-        return t;
+        KFMutex::AutoLock lock(_mutex);
+        if (_threads == nullptr)
+            return;
+
+        int count = _threads->GetElementCount();
+        for (int i = 0; i < count; i++) {
+            IKFAsyncThreadWorker_I* thread = nullptr;
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread) {
+                thread->GetIdleStats(stats);
+                thread->Recycle();
+            }
+        }
     }
-    
-    KF_RESULT InternalPutWorkItem(IKFAsyncWorkItem_I* workItem, IKFAsyncThreadWorker_I::WorkItemPriority level)
+
+    virtual void GetDropStats(KFAsyncDropStats* stats)
     {
+        stats->Cancelled += _cancelled_drops.load(std::memory_order_relaxed);
+        stats->Expired += _expired_drops.load(std::memory_order_relaxed);
+
         KFMutex::AutoLock lock(_mutex);
-        KF_RESULT result = KF_OK;
+        if (_threads == nullptr)
+            return;
+
         int count = _threads->GetElementCount();
-        KFLOG_T("%s -> InternalPutWorkItem (Thread Count %d)", "GroupWorker", count);
+        for (int i = 0; i < count; i++) {
+            IKFAsyncThreadWorker_I* thread = nullptr;
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread) {
+                thread->GetDropStats(stats);
+                thread->Recycle();
+            }
+        }
+    }
+
+    virtual void GetStats(KFAsyncWorkerStats* stats)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        if (_threads == nullptr)
+            return;
+
+        int count = _threads->GetElementCount();
+        stats->CurrentThreads = count;
+        for (int i = 0; i < count; i++) {
+            IKFAsyncThreadWorker_I* thread = nullptr;
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread == nullptr)
+                continue;
+            if (stats->ListedThreads < KF_ASYNC_STATS_MAX_THREADS)
+                stats->ThreadQueueDepth[stats->ListedThreads++] = thread->GetItemCount();
+            thread->GetExecStats(stats);
+            thread->Recycle();
+        }
+
+        //被移出线程组的线程还在执行阻塞的任务，执行统计仍然算在线程组里
+        if (_stalled_threads) {
+            count = _stalled_threads->GetElementCount();
+            for (int i = 0; i < count; i++) {
+                IKFBaseObject* obj = nullptr;
+                _stalled_threads->GetElementNoRef(i, &obj);
+                if (obj)
+                    static_cast<IKFAsyncThreadWorker_I*>(obj)->GetExecStats(stats);
+            }
+        }
+
+        stats->Executed += _retired_stats.Executed;
+        stats->BusyTimeUs += _retired_stats.BusyTimeUs;
+        stats->WaitTimeUs += _retired_stats.WaitTimeUs;
+        if (_retired_stats.WaitMaxUs > stats->WaitMaxUs)
+            stats->WaitMaxUs = _retired_stats.WaitMaxUs;
+        for (int i = 0; i < KF_ASYNC_STATS_WAIT_BUCKETS; i++)
+            stats->WaitHistogram[i] += _retired_stats.WaitHistogram[i];
+    }
+
+    virtual int GetQueueDepth(int priority)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        if (_threads == nullptr)
+            return 0;
+
+        int depth = 0;
+        int count = _threads->GetElementCount();
+        for (int i = 0; i < count; i++) {
+            IKFAsyncThreadWorker_I* thread = nullptr;
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread == nullptr)
+                continue;
+            if (priority == KF_ASYNC_PRIORITY_ALL)
+                depth += thread->GetItemCount();
+            else
+                depth += thread->GetLevelItemCount(IKFAsyncThreadWorker_I::WorkItemPriority(priority));
+            thread->Recycle();
+        }
+        return depth;
+    }
+
+    virtual bool StealWorkItems(IKFAsyncThreadWorker_I* thief)
+    {
+        if (!_work_stealing)
+            return false;
+
+        //不加线程组的锁：从快照中随机的位置开始探测几个线程，只读取它们的任务计数，
+        //选待执行任务最多的一个，由 StealItems 尝试它的消费者锁（拿不到就放弃）
+        IKFAsyncThreadWorker_I* victim = nullptr;
+        int victim_tasks = 0;
+        _steal_readers.fetch_add(1);
+        auto snapshot = _steal_snapshot.load();
+        if (snapshot) {
+            int count = snapshot->Count;
+            int probes = _KF_MIN(count, WORKER_STEAL_PROBE_COUNT);
+            int start = (int)(NextStealProbe() % (KF_UINT32)count);
+            for (int i = 0; i < probes; i++) {
+                auto thread = snapshot->Threads[(start + i) % count];
+                int tasks = thread != thief ? thread->GetItemCount() : 0;
+                if (tasks > victim_tasks) {
+                    victim = thread;
+                    victim_tasks = tasks;
+                }
+            }
+            if (victim)
+                victim->Retain(); //离开快照以后快照可能被释放
+        }
+        _steal_readers.fetch_sub(1);
+        if (victim == nullptr)
+            return false;
+
+        KFLOG_T("%s -> StealWorkItems: Victim has %d tasks.", "GroupWorker", victim_tasks);
+        int stolen = victim->StealItems(thief);
+        victim->Recycle();
+        return stolen > 0;
+    }
+
+    virtual bool WouldBlock(int count)
+    { return _queue_limit != nullptr && _queue_limit->WouldBlock(count); }
+    
+public:
+    //watchdog 定期调用：线程执行一个任务超过 _stall_timeout_ms 并且后面还有排队的任务时，
+    //把排队的任务迁移到空闲线程（没有就新建一个溢出线程），阻塞的线程移出线程组，执行完当前任务后退出
+    void CheckStalledThreads()
+    {
+        IKFAsyncThreadWorker_I** stalled = nullptr;
+        int stalledCount = 0;
+        {
+            KFMutex::AutoLock lock(_mutex);
+            if (_shutdown || _stalled_threads == nullptr)
+                return;
+
+            //已经执行完阻塞任务的线程不再计入溢出线程数
+            for (int i = _stalled_threads->GetElementCount() - 1; i >= 0; i--) {
+                IKFBaseObject* obj = nullptr;
+                _stalled_threads->GetElementNoRef(i, &obj);
+                if (obj && static_cast<IKFAsyncThreadWorker_I*>(obj)->GetExecuteElapsedTime() < 0) {
+                    static_cast<IKFAsyncThreadWorker_I*>(obj)->GetExecStats(&_retired_stats);
+                    _stalled_threads->RemoveElement(i, nullptr);
+                }
+            }
+
+            //锁内只选出阻塞的线程，迁移队列（可能调用任务的丢弃回调）和启动溢出线程都在锁外进行
+            int count = _threads->GetElementCount();
+            for (int i = 0; i < count; i++) {
+                IKFAsyncThreadWorker_I* thread = nullptr;
+                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                              _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                              &thread);
+                if (thread == nullptr)
+                    continue;
+                if (thread->GetExecuteElapsedTime() < _stall_timeout_ms || thread->GetItemCount() == 0) {
+                    thread->Recycle();
+                    continue;
+                }
+                if (stalled == nullptr)
+                    stalled = (IKFAsyncThreadWorker_I**)malloc(sizeof(IKFAsyncThreadWorker_I*) * count);
+                if (stalled == nullptr) {
+                    thread->Recycle();
+                    break;
+                }
+                stalled[stalledCount++] = thread; //持有引用
+            }
+        }
+
+        for (int i = 0; i < stalledCount; i++) {
+            MigrateStalledThread(stalled[i]);
+            stalled[i]->Recycle();
+        }
+        if (stalled)
+            free(stalled);
+    }
+
+private:
+    //不持有锁时调用：只在选择目标线程和更新 _threads / _stalled_threads 时加锁
+    bool MigrateStalledThread(IKFAsyncThreadWorker_I* thread)
+    {
+        IKFAsyncThreadWorker_I* target = nullptr;
+        int count = 0;
+        {
+            KFMutex::AutoLock lock(_mutex);
+            if (_shutdown)
+                return false;
+            if (_stalled_threads->GetElementCount() >= MAX_OVERFLOW_THREAD_COUNT) {
+                KFLOG_WARN_T("%s -> CheckStalledThreads: Overflow Threads Limit Reached.", "GroupWorker");
+                return false;
+            }
+
+            count = _threads->GetElementCount();
+            for (int i = 0; i < count && target == nullptr; i++) {
+                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                              _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                              &target);
+                if (target && (target == thread || !target->IsIdle())) {
+                    target->Recycle();
+                    target = nullptr;
+                }
+            }
+        }
+
+        //没有空闲的线程，新建一个溢出线程（阻塞的线程移出以后，线程组的线程数不变）
+        bool overflow = false;
+        if (target == nullptr) {
+            auto newThread = CreateThreadWorker(count);
+            if (newThread == nullptr)
+                return false;
+            if (KF_FAILED(newThread->TaskQueueStartup(true))) {
+                newThread->TaskQueueShutdown();
+                newThread->Recycle();
+                return false;
+            }
+            target = newThread;
+            overflow = true;
+        }
+
+        thread->MoveCurrentTaskQueue(target);
+        bool moved = thread->IsTaskQueueMoved();
+        bool discard = overflow && !moved; //线程正在被偷任务（或者任务刚执行完），下次再检查
+        if (moved) {
+            KFMutex::AutoLock lock(_mutex);
+            //迁移期间 _threads 可能已经变化（空闲线程退出、Shutdown），按对象重新查找阻塞的线程
+            int index = -1;
+            count = _threads->GetElementCount();
+            for (int i = 0; i < count && index < 0; i++) {
+                IKFBaseObject* obj = nullptr;
+                _threads->GetElementNoRef(i, &obj);
+                if (obj && static_cast<IKFAsyncThreadWorker_I*>(obj) == thread)
+                    index = i;
+            }
+            if (index >= 0) {
+                KFLOG_INFO_T("%s -> MigrateStalledThread: Thread %d Stalled %d ms, Queue Moved to %s Thread.", "GroupWorker",
+                             index, thread->GetExecuteElapsedTime(), overflow ? "Overflow" : "Idle");
+                _stalled_threads->AddElement(thread);
+                _threads->RemoveElement(index, nullptr);
+            }
+            if (overflow) {
+                if (_shutdown)
+                    discard = true; //迁移期间线程组已经关闭，溢出线程不会再被 Shutdown 关闭
+                else
+                    _threads->AddElement(target);
+            }
+            PublishStealSnapshot();
+        }
+        if (discard)
+            target->TaskQueueShutdown();
+        target->Recycle();
+        return moved;
+    }
+
+    char* MakeThreadWorkerName(int index)
+    {
+        if (_name == nullptr)
+            return nullptr;
+
+        auto c = (char*)malloc(strlen(_name) + 128);
+        if (c)
+            sprintf(c, "%s : Worker %d", _name, index);
+        return c;
+    }
+
+    KF_RESULT SetupAffinity(const KFAsyncWorkerConfig* config)
+    {
+        _affinity_mode = config->AffinityMode;
+        if (_affinity_mode == KF_ASYNC_AFFINITY_NONE)
+            return KF_OK;
+
+        if (_affinity_mode == KF_ASYNC_AFFINITY_SPREAD_NUMA) {
+            _numa_nodes = KFSystemNumaNodeCount();
+            KFLOG_T("%s -> Startup: Spread to %d NUMA Nodes.", "GroupWorker", _numa_nodes);
+            return KF_OK;
+        }
+
+        //没有指定 CPU 的 PIN_CORE 使用所有 CPU
+        int count = config->AffinityCpuCount;
+        if (config->AffinityCpus == nullptr || count <= 0)
+            count = KFSystemCpuCount();
+        _affinity_cpus = (int*)malloc(sizeof(int) * _KF_MAX(count, 1));
+        if (_affinity_cpus == nullptr)
+            return KF_OUT_OF_MEMORY;
+        for (int i = 0; i < count; i++)
+            _affinity_cpus[i] = (config->AffinityCpus && config->AffinityCpuCount > 0) ? config->AffinityCpus[i] : i;
+        _affinity_cpu_count = count;
+        return KF_OK;
+    }
+
+    void ApplyAffinity(ThreadWorker* thread, int index)
+    {
+        switch (_affinity_mode) {
+        case KF_ASYNC_AFFINITY_CPU_SET:
+            thread->SetAffinity(_affinity_cpus, _affinity_cpu_count);
+            break;
+        case KF_ASYNC_AFFINITY_PIN_CORE:
+            if (_affinity_cpu_count > 0)
+                thread->SetAffinity(&_affinity_cpus[index % _affinity_cpu_count], 1);
+            break;
+        case KF_ASYNC_AFFINITY_SPREAD_NUMA:
+            {
+                //按照节点轮流分配，同一个节点上的线程共享这个节点的所有 CPU
+                int node = index % _numa_nodes;
+                int count = KFSystemNumaNodeCpus(node, nullptr, 0);
+                if (count <= 0)
+                    break;
+                auto cpus = (int*)malloc(sizeof(int) * count);
+                if (cpus == nullptr)
+                    break;
+                count = KFSystemNumaNodeCpus(node, cpus, count);
+                thread->SetAffinity(cpus, count);
+                free(cpus);
+            }
+            break;
+        }
+    }
+
+    ThreadWorker* CreateThreadWorker(int index)
+    {
+        auto name = MakeThreadWorkerName(index);
+        auto t = new(std::nothrow) ThreadWorker(name);
+        if (name)
+            free(name);
+        if (t == nullptr)
+            return nullptr;
+        //常驻线程不会因为空闲而退出
+        t->SetTimeout(index < _min_threads ? 0 : _keep_alive_ms);
+        t->SetIdlePolicy(_idle_policy);
+        ApplyAffinity(t, index);
+        t->SetOwnerGroup(this);
+        t->SetQueueLimit(_queue_limit);
+        if (_work_stealing)
+            t->SetStealGroup(this);
+        return t;
+    }
+    
+    //提交一个 WorkItem：先按照容量取得排队的名额，再交给当前线程（快速路径）或者某个 ThreadWorker
+    KF_RESULT SubmitWorkItem(IKFAsyncWorkItem_I* workItem, IKFAsyncThreadWorker_I::WorkItemPriority level)
+    {
+        bool caller_runs = false;
+        auto r = AcquireQueueSlots(1, &caller_runs);
+        if (KF_FAILED(r))
+            return r;
+        if (caller_runs) {
+            RunOnCaller(workItem);
+            return KF_OK;
+        }
+
+        if (PutLocalWorkItem(workItem, level))
+            return KF_OK;
+
+        KFMutex::AutoLock lock(_mutex);
+        r = _shutdown ? KF_SHUTDOWN : InternalPutWorkItem(workItem, level);
+        if (KF_FAILED(r))
+            ReleaseQueueSlots(1);
+        return r;
+    }
+
+    //按照容量和溢出策略为 count 个任务取得排队的名额（不能持有线程组的锁，BLOCK 会等待）
+    //返回 KF_OK 并且 *caller_runs 为 true 时，任务不入队，由提交的线程直接执行
+    KF_RESULT AcquireQueueSlots(int count, bool* caller_runs)
+    {
+        *caller_runs = false;
+        if (_queue_limit == nullptr || _queue_limit->TryAcquire(count))
+            return KF_OK;
+
+        switch (_overflow_policy) {
+        case KF_ASYNC_OVERFLOW_BLOCK: {
+            auto current = kCurrentThreadWorker;
+            if (current && current->IsOwnedBy(this))
+                break; //Worker 自己的线程等待名额可能永远等不到（队列要靠这些线程消化），直接入队
+            return _queue_limit->AcquireWait(count, _overflow_timeout_ms);
+        }
+        case KF_ASYNC_OVERFLOW_DROP_OLDEST:
+            DropOldestItems(count); //尽量腾出名额（任务正在被取走时可能暂时超过容量）
+            break;
+        case KF_ASYNC_OVERFLOW_CALLER_RUNS:
+            *caller_runs = true;
+            return KF_OK;
+        default:
+            return KF_BUF_TOO_SMALL;
+        }
+        _queue_limit->ForceAcquire(count);
+        return KF_OK;
+    }
+
+    void ReleaseQueueSlots(int count)
+    { if (_queue_limit) _queue_limit->Release(count); }
+
+    void DropOldestItems(int count)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        if (_shutdown)
+            return;
+        for (int i = 0; i < count; i++) {
+            auto victim = FindBusiestThread(nullptr, nullptr);
+            if (victim == nullptr)
+                return;
+            bool dropped = victim->DropOldestItem();
+            victim->Recycle();
+            if (!dropped)
+                return;
+        }
+    }
+
+    //KF_ASYNC_OVERFLOW_CALLER_RUNS：在提交的线程上执行，仍然检查取消令牌和期限
+    void RunOnCaller(IKFAsyncWorkItem_I* workItem)
+    {
+        auto drop = workItem->CheckDrop();
+        if (drop == IKFAsyncWorkItem_I::DropReason::NotDropped) {
+            KFAsyncRunWorkItem(workItem);
+            return;
+        }
+        if (drop == IKFAsyncWorkItem_I::DropReason::DropCancelled)
+            _cancelled_drops.fetch_add(1, std::memory_order_relaxed);
+        else
+            _expired_drops.fetch_add(1, std::memory_order_relaxed);
+        workItem->OnDiscarded();
+    }
+
+    static KF_UINT32 NextStealProbe()
+    {
+        KF_UINT32 x = kStealProbeSeed;
+        if (x == 0)
+            x = (KF_UINT32)(uintptr_t)&kStealProbeSeed | 1; //每个线程不同的初始值
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        kStealProbeSeed = x;
+        return x;
+    }
+
+    //用当前的 _threads 重新发布 work-stealing 的快照（必须持有锁）
+    void PublishStealSnapshot()
+    {
+        if (!_work_stealing)
+            return;
+
+        StealSnapshot* snapshot = nullptr;
+        int count = _threads->GetElementCount();
+        if (count > 0) {
+            snapshot = (StealSnapshot*)malloc(sizeof(StealSnapshot) + sizeof(IKFAsyncThreadWorker_I*) * (count - 1));
+            if (snapshot == nullptr) {
+                KFLOG_ERROR_T("%s -> PublishStealSnapshot: Alloc Memory Failed.", "GroupWorker");
+                return; //旧的快照仍然持有线程的引用，可以继续使用，只是看不到新的线程
+            }
+            snapshot->Count = 0;
+            for (int i = 0; i < count; i++) {
+                IKFAsyncThreadWorker_I* thread = nullptr;
+                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                              _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                              &thread);
+                if (thread)
+                    snapshot->Threads[snapshot->Count++] = thread;
+            }
+            if (snapshot->Count == 0) {
+                free(snapshot);
+                snapshot = nullptr;
+            }
+        }
+
+        //读取快照的线程只做几次原子读取和一次 Retain，等待的时间很短
+        auto old = _steal_snapshot.exchange(snapshot);
+        while (_steal_readers.load() > 0)
+            KFSwitchToThread();
+        FreeStealSnapshot(old);
+    }
+    static void FreeStealSnapshot(StealSnapshot* snapshot)
+    {
+        if (snapshot == nullptr)
+            return;
+        for (int i = 0; i < snapshot->Count; i++)
+            snapshot->Threads[i]->Recycle();
+        free(snapshot);
+    }
+
+    //待执行任务最多的线程（不包括 exclude），没有排队的任务返回 nullptr（必须持有锁）
+    IKFAsyncThreadWorker_I* FindBusiestThread(IKFAsyncThreadWorker_I* exclude, int* task_count)
+    {
+        IKFAsyncThreadWorker_I* busiest = nullptr;
+        int busiest_tasks = 0;
+        int count = _threads->GetElementCount();
+        for (int i = 0; i < count; i++) {
+            IKFAsyncThreadWorker_I* thread = nullptr;
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread == nullptr)
+                continue;
+            int tasks = thread != exclude ? thread->GetItemCount() : 0;
+            if (tasks > busiest_tasks) {
+                if (busiest)
+                    busiest->Recycle();
+                busiest = thread;
+                busiest_tasks = tasks;
+            }else{
+                thread->Recycle();
+            }
+        }
+        if (task_count)
+            *task_count = busiest_tasks;
+        return busiest;
+    }
+
+    //在本线程组的线程里提交（Callback 里的后续任务）：直接交给当前线程，不加线程组的锁，也不通知别的线程
+    //返回 false 表示不是本线程组的线程（或者线程已经退出、队列已经被移走），需要走正常的提交
+    bool PutLocalWorkItem(IKFAsyncWorkItem_I* workItem, IKFAsyncThreadWorker_I::WorkItemPriority level)
+    {
+        auto current = kCurrentThreadWorker;
+        if (current == nullptr || !current->IsOwnedBy(this))
+            return false;
+        return KF_SUCCEEDED(current->PutLocalItem(workItem, level));
+    }
+
+    KF_RESULT InternalPutWorkItems(IKFAsyncWorkItem_I** workItems, int count, IKFAsyncThreadWorker_I::WorkItemPriority level)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        if (_shutdown)
+            return KF_SHUTDOWN;
+
+        //并行的 Worker 按需要补足线程（最多每个任务一个线程），无上限的 Worker 最多补到 CPU 核心数
+        int threads = _threads->GetElementCount();
+        int targets = _work_stealing ? count : 1;
+        if (_max_threads != KF_ASYNC_WORKER_THREADS_INFINITE)
+            targets = _KF_MIN(targets, _max_threads);
+        else
+            targets = _KF_MIN(targets, _KF_MAX(threads, KFSystemCpuCount()));
+
+        while (threads < targets) {
+            auto newThread = CreateThreadWorker(threads);
+            if (newThread == nullptr)
+                break;
+            if (KF_FAILED(newThread->TaskQueueStartup(true)) || !_threads->AddElement(newThread)) {
+                newThread->TaskQueueShutdown();
+                newThread->Recycle();
+                break;
+            }
+            newThread->Recycle();
+            threads++;
+            PublishStealSnapshot();
+        }
+        if (threads == 0)
+            return KF_INVALID_STATE;
+        targets = _KF_MIN(targets, threads);
+        KFLOG_T("%s -> InternalPutWorkItems: Split to %d Threads.", "GroupWorker", targets);
+
+        //把任务按连续的段分给每个线程，每个线程一次入队
+        int chunk = (count + targets - 1) / targets;
+        int first = _next_thread % threads;
+        _next_thread = first + targets;
+        KF_RESULT result = KF_OK;
+        for (int i = 0, offset = 0; i < targets && offset < count; i++, offset += chunk) {
+            IKFAsyncThreadWorker_I* thread = nullptr;
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, (first + i) % threads,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread == nullptr) {
+                result = KF_UNEXPECTED;
+                continue;
+            }
+            auto r = thread->PutItems(workItems + offset, _KF_MIN(chunk, count - offset), level);
+            if (KF_FAILED(r))
+                result = r;
+            thread->Recycle();
+        }
+        return result;
+    }
+
+    KF_RESULT InternalPutWorkItem(IKFAsyncWorkItem_I* workItem, IKFAsyncThreadWorker_I::WorkItemPriority level)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        int count = _threads->GetElementCount();
+        KFLOG_T("%s -> InternalPutWorkItem (Thread Count %d)", "GroupWorker", count);
+
+        //优先找已经创建的线程中空闲的线程来执行（只读取空闲标记，不去锁每个线程的任务队列）
+        IKFAsyncThreadWorker_I* thread = nullptr;
+        for (int i = 0; i < count; i++) {
+            KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
+                                                          _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                          &thread);
+            if (thread) {
+                if (thread->IsIdle())
+                    break; //使用这个线程
+                thread->Recycle();
+                thread = nullptr;
+            }
+        }
+
+        if (thread != nullptr) {
+            KFLOG_T("%s -> InternalPutWorkItem: Select to IdleThread.", "GroupWorker");
+            auto result = thread->PutItem(workItem, level);
+            thread->Recycle();
+            return result;
+        }
+
+        bool toCreateNew = (count < _max_threads);
+        if (_max_threads == KF_ASYNC_WORKER_THREADS_INFINITE)
+            toCreateNew = true; //无上限创建新的线程数
+
+        //如果当前已经创建的 ThreadWorker 小于可创建的最大数目，则可以创建新的执行 Callback
+        if (toCreateNew) {
+            KFLOG_T("%s -> InternalPutWorkItem: Select to CreateThread.", "GroupWorker");
+            auto newThread = CreateThreadWorker(count); //创建一个新的 ThreadWorker
+            if (newThread == nullptr) {
+                KFLOG_ERROR_T("%s -> InternalPutWorkItem: CreateThreadWorker Failed.", "GroupWorker");
+                return KF_OUT_OF_MEMORY;
+            }
+
+            //启动这个线程的任务队列
+            if (KF_FAILED(newThread->TaskQueueStartup(false))) {
+                KFLOG_ERROR_T("%s -> InternalPutWorkItem: TaskQueueStartup Failed.", "GroupWorker");
+                newThread->Recycle();
+                return KF_INVALID_STATE;
+            }
+
+            //提交任务
+            if (KF_FAILED(newThread->PutItem(workItem, level))) {
+                newThread->TaskQueueShutdown();
+                newThread->Recycle();
+                return KF_INVALID_STATE;
+            }
+
+            //把线程添加到组
+            auto result = _threads->AddElement(newThread) ? KF_OK : KF_OUT_OF_MEMORY;
+            newThread->Recycle();
+            PublishStealSnapshot();
+            return result;
+        }
+
+        //如果线程已经饱和，轮流提交给每个线程，积压的任务由空闲下来的线程偷走执行
+        int exec_thread_index = _next_thread % count;
+        _next_thread = exec_thread_index + 1;
+        KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, exec_thread_index,
+                                                      _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
+                                                      &thread);
+        if (thread == nullptr)
+            return KF_UNEXPECTED;
+
+        auto result = thread->PutItem(workItem, level); //提交执行
+        thread->Recycle();
+
+        KFLOG_T("%s -> InternalPutWorkItem: Submit to Thread %d", "GroupWorker", exec_thread_index);
+        return result;
+    }
+};
+
+// ***************
+
+//Strand：串行（FIFO、同一时刻只执行一个任务）的任务队列，没有自己的线程，借用一个 Worker 的线程执行
+//队列从空变为非空时向 Worker 提交一次 Drain，Drain 连续执行一批任务后重新排队，把线程让给别的任务
+class StrandWorker : public IKFAsyncGroupWorker_I
+{
+    KF_IMPL_DECL_REFCOUNT;
+
+    KASYNCOBJECT _pool; //执行 Drain 的 Worker（持有引用）
+    IKFAsyncGroupWorker_I* _host; //_pool 的线程组，用来提交 Drain
+    MpscQueue<KFAsyncQueueNode> _queue;
+    std::atomic<int> _pending; //已经入队、还没有执行完的任务数，从 0 变为 1 的提交者负责提交 Drain
+    std::atomic<bool> _shutdown;
+    std::atomic<KF_INT64> _cancelled_drops, _expired_drops;
+    WorkerExecStats _exec_stats; //同一时刻只有一个 Drain 写入
+
+public:
+    StrandWorker(KASYNCOBJECT pool, IKFAsyncGroupWorker_I* host) throw() : _ref_count(1), _pool(pool), _host(host), _pending(0), _shutdown(true), _cancelled_drops(0), _expired_drops(0)
+    { KFAsyncWorkerLockRef(_pool); _host->Retain(); }
+    virtual ~StrandWorker() throw()
+    { _host->Recycle(); KFAsyncDestroyWorker(_pool); }
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _INTERNAL_KF_INTERFACE_ID_ASYNC_GROUP_WORKER)) {
+            *ppv = static_cast<IKFAsyncGroupWorker_I*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+
+    virtual KREF Retain()
+    { KF_IMPL_RETAIN_FUNC(_ref_count); }
+    virtual KREF Recycle()
+    { KF_IMPL_RECYCLE_FUNC(_ref_count); }
+
+public:
+    virtual KF_RESULT Startup(const KFAsyncWorkerConfig*)
+    {
+        _shutdown.store(false);
+        return KF_OK;
+    }
+
+    virtual KF_RESULT Shutdown()
+    {
+        //还在排队的任务由 Drain 丢弃（和 ThreadWorker 退出时一样不执行）
+        _shutdown.store(true);
+        return KF_OK;
+    }
+
+    //Strand 只有一个 FIFO 队列，options->Priority 不改变执行顺序
+    virtual KF_RESULT PutWorkItem(IKFAsyncResult* result, const KFAsyncWorkItemOptions* options)
+    {
+        if (result == nullptr || options == nullptr)
+            return KF_INVALID_ARG;
+        if (_shutdown.load())
+            return KF_SHUTDOWN;
+
+        IKFAsyncResult_I* callback = nullptr;
+        KFBaseGetInterface(result, _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT, &callback);
+        if (callback == nullptr) {
+            KFLOG_ERROR_T("%s -> PutWorkItem: Callback is Invalid.", "StrandWorker");
+            return KF_NO_INTERFACE;
+        }
+
+        auto workItem = new(std::nothrow) WorkItem(IKFAsyncWorkItem_I::WorkItemState::ExecuteTask, callback, options->Priority);
+        callback->Recycle();
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutWorkItem: Alloc Memory Failed.", "StrandWorker");
+            return KF_OUT_OF_MEMORY;
+        }
+        workItem->SetDropCondition(options->CancelToken, options->DeadlineMs);
+
+        PushItems(workItem, workItem, 1); //队列持有 WorkItem 的引用
+        return KF_OK;
+    }
+
+    virtual KF_RESULT PutWorkItems(IKFAsyncResult** results, int count, int priority)
+    {
+        if (results == nullptr || count <= 0)
+            return KF_INVALID_ARG;
+        if (_shutdown.load())
+            return KF_SHUTDOWN;
+
+        //先创建所有 WorkItem 并串成一条链，全部成功以后一次入队
+        WorkItem* first = nullptr;
+        WorkItem* last = nullptr;
+        KF_RESULT r = KF_OK;
+        for (int i = 0; i < count; i++) {
+            IKFAsyncResult_I* callback = nullptr;
+            if (results[i])
+                KFBaseGetInterface(results[i], _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT, &callback);
+            if (callback == nullptr) {
+                KFLOG_ERROR_T("%s -> PutWorkItems: Callback %d is Invalid.", "StrandWorker", i);
+                r = KF_NO_INTERFACE;
+                break;
+            }
+            auto workItem = new(std::nothrow) WorkItem(IKFAsyncWorkItem_I::WorkItemState::ExecuteTask, callback, priority);
+            callback->Recycle();
+            if (workItem == nullptr) {
+                KFLOG_ERROR_T("%s -> PutWorkItems: Alloc Memory Failed.", "StrandWorker");
+                r = KF_OUT_OF_MEMORY;
+                break;
+            }
+            if (last)
+                last->GetQueueNode()->Next.store(workItem->GetQueueNode(), std::memory_order_relaxed);
+            else
+                first = workItem;
+            last = workItem;
+        }
+
+        if (KF_FAILED(r)) {
+            auto node = first ? first->GetQueueNode() : nullptr;
+            while (node) {
+                auto next = node->Next.load(std::memory_order_relaxed);
+                node->Item->Recycle();
+                node = next;
+            }
+            return r;
+        }
+        PushItems(first, last, count);
+        return KF_OK;
+    }
+
+    virtual KF_RESULT PutWorkFunction(KFAsyncWorkFunc func, void* context, int priority)
+    {
+        if (func == nullptr)
+            return KF_INVALID_ARG;
+        if (_shutdown.load())
+            return KF_SHUTDOWN;
+
+        auto workItem = new(std::nothrow) WorkItem(func, context, priority);
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutWorkFunction: Alloc Memory Failed.", "StrandWorker");
+            return KF_OUT_OF_MEMORY;
+        }
+        PushItems(workItem, workItem, 1);
+        return KF_OK;
+    }
+
+    virtual KF_RESULT PutInlineFunction(const KFAsyncInlineFuncOps* ops, void* source, int priority)
+    {
+        if (ops == nullptr)
+            return KF_INVALID_ARG;
+        if (_shutdown.load())
+            return KF_SHUTDOWN;
+
+        auto workItem = WorkItem::CreateInline(ops, source, priority);
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutInlineFunction: Construct Failed.", "StrandWorker");
+            return KF_OUT_OF_MEMORY;
+        }
+        PushItems(workItem, workItem, 1);
+        return KF_OK;
+    }
+
+    //Strand 的队列本来就是 FIFO，也没有容量限制
+    virtual KF_RESULT PutDrainFunction(KFAsyncWorkFunc func, KFAsyncWorkFunc discard, void* context, int priority)
+    {
+        if (func == nullptr)
+            return KF_INVALID_ARG;
+        if (_shutdown.load())
+            return KF_SHUTDOWN;
+
+        auto workItem = new(std::nothrow) WorkItem(func, context, priority);
+        if (workItem == nullptr) {
+            KFLOG_ERROR_T("%s -> PutDrainFunction: Alloc Memory Failed.", "StrandWorker");
+            return KF_OUT_OF_MEMORY;
+        }
+        workItem->SetDiscardHandler(discard);
+        PushItems(workItem, workItem, 1);
+        return KF_OK;
+    }
+
+    virtual int GetMaxThreads() { return 1; }
+    virtual int GetCurrentThreads() { return _pending.load(std::memory_order_relaxed) > 0 ? 1 : 0; }
+    virtual KF_RESULT Prewarm(int) { return KF_OK; } //线程属于底层的 Worker
+    virtual void GetIdleStats(KFAsyncIdleStats*) {}
+
+    virtual void GetDropStats(KFAsyncDropStats* stats)
+    {
+        stats->Cancelled += _cancelled_drops.load(std::memory_order_relaxed);
+        stats->Expired += _expired_drops.load(std::memory_order_relaxed);
+    }
+
+    virtual void GetStats(KFAsyncWorkerStats* stats)
+    {
+        stats->CurrentThreads = GetCurrentThreads();
+        stats->ListedThreads = 1;
+        stats->ThreadQueueDepth[0] = _pending.load(std::memory_order_relaxed);
+        _exec_stats.AddTo(stats);
+    }
+
+    virtual int GetQueueDepth(int) { return _pending.load(std::memory_order_relaxed); } //不区分优先级
+
+    virtual bool StealWorkItems(IKFAsyncThreadWorker_I*) { return false; } //Strand 的任务不能被偷走并行执行
+    virtual bool WouldBlock(int) { return false; } //Strand 不限制容量（Drain 占用底层 Worker 的名额）
+
+private:
+    void PushItems(WorkItem* first, WorkItem* last, int count)
+    {
+        _queue.PushChain(first->GetQueueNode(), last->GetQueueNode());
+        if (_pending.fetch_add(count) == 0)
+            ScheduleDrain();
+    }
+
+    void ScheduleDrain()
+    {
+        Retain(); //Drain 执行完（或者被丢弃）之前 Strand 不能销毁
+        auto hr = _host->PutDrainFunction(&StrandWorker::DrainProc, &StrandWorker::DiscardProc, this, KF_ASYNC_PRIORITY_NORMAL);
+        if (KF_FAILED(hr)) {
+            //底层 Worker 不接受 Drain（内存不足、KF_ASYNC_OVERFLOW_REJECT 的队列已满、或者已经关闭），
+            //任务已经在 Strand 的队列里，只能在当前线程执行，仍然保证串行
+            KFLOG_WARN_T("%s -> ScheduleDrain: Put to pool Failed (%d), drain inline.", "StrandWorker", hr);
+            Drain();
+        }
+    }
+
+    static void DrainProc(void* context)
+    { static_cast<StrandWorker*>(context)->Drain(); }
+    static void DiscardProc(void* context)
+    { static_cast<StrandWorker*>(context)->AbandonDrain(); }
+
+    //底层 Worker 关闭时丢弃了 Drain：没有别的线程会再执行这个 Strand，丢弃排队的任务，归还 Drain 的引用
+    //_pending 回到 0 以后，下一个提交者会重新提交 Drain（底层 Worker 已经关闭时会失败，在提交的线程上执行）
+    void AbandonDrain()
+    {
+        KFLOG_WARN_T("%s -> AbandonDrain: Drain Discarded by Pool.", "StrandWorker");
+        while (1) {
+            auto node = _queue.Pop();
+            if (node == nullptr) {
+                KFSwitchToThread();
+                continue;
+            }
+            node->Item->OnDiscarded();
+            node->Item->Recycle();
+            if (_pending.fetch_sub(1) == 1)
+                break;
+        }
+        Recycle();
+    }
+
+    void Drain()
+    {
+        int executed = 0;
+        while (1) {
+            auto node = _queue.Pop();
+            if (node == nullptr) {
+                //_pending > 0 说明有生产者正在入队的中途，稍等即可
+                KFSwitchToThread();
+                continue;
+            }
+
+            IKFAsyncWorkItem_I* workItem = node->Item;
+            if (_shutdown.load(std::memory_order_relaxed)) {
+                workItem->OnDiscarded(); //Strand 已经销毁，丢弃剩下的任务
+                workItem->Recycle();
+            }else{
+                ExecuteItem(workItem);
+            }
+
+            if (_pending.fetch_sub(1) == 1)
+                break; //队列空了，下一个提交者会重新提交 Drain
+
+            if (++executed >= WORKER_STRAND_BATCH_COUNT) {
+                //执行了一批，重新排到底层 Worker 的队尾，Drain 的引用转交给新的提交
+                if (KF_SUCCEEDED(_host->PutDrainFunction(&StrandWorker::DrainProc, &StrandWorker::DiscardProc, this, KF_ASYNC_PRIORITY_NORMAL)))
+                    return;
+                executed = 0;
+            }
+        }
+        Recycle();
+    }
+
+    void ExecuteItem(IKFAsyncWorkItem_I* workItem)
+    {
+        auto drop = workItem->CheckDrop();
+        if (drop != IKFAsyncWorkItem_I::DropReason::NotDropped) {
+            if (drop == IKFAsyncWorkItem_I::DropReason::DropCancelled)
+                _cancelled_drops.fetch_add(1, std::memory_order_relaxed);
+            else
+                _expired_drops.fetch_add(1, std::memory_order_relaxed);
+            workItem->OnDiscarded();
+            workItem->Recycle();
+            return;
+        }
+
+        auto start_us = KFAsyncNowUs();
+        KFAsyncRunWorkItem(workItem);
+        _exec_stats.OnExecuted(start_us - workItem->GetEnqueueTime(), KFAsyncNowUs() - start_us);
+        workItem->Recycle();
+    }
+};
+
+// ***************
+
+static KFMutex kWatchdog_Mutex;
+static IKFArrayList* kWatchdog_Groups = nullptr; //开启了阻塞检测的线程组
+static bool kWatchdog_Running = false;
 
-        bool toCreateNew = (count < _max_threads);
-        if (_max_threads == KF_ASYNC_WORKER_THREADS_INFINITE)
-            toCreateNew = true; //无上限创建新的线程数
+//阻塞检测线程：有线程组注册时启动，所有线程组都注销以后退出
+class WorkerWatchdog : protected KFThreadObject
+{
+    KF_IMPL_DECL_REFCOUNT;
 
-        //如果当前已经创建的 ThreadWorker 小于可创建的最大数目，则可以创建新的执行 Callback
-        if (toCreateNew) {
-            KFLOG_T("%s -> InternalPutWorkItem: Select to CreateThread.", "GroupWorker");
-            IKFAsyncThreadWorker_I* thread = nullptr;
-            for (int i = 0; i < count; i++) {
-                //优先找已经创建的线程中的空闲中的无任务的线程来执行
-                if (thread) {
-                    thread->Recycle();
-                    thread = nullptr;
-                }
-                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
-                                                              _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
-                                                              &thread);
-                if (thread) {
-                    if (thread->GetItemCount() == 0) //有无任务的线程
-                        break; //使用这个线程
-                }
-            }
-            
-            if (thread->GetItemCount() == 0) {
-                //如果有线程处于无任务状态，不需要创建新的了，直接提交给这个线程执行
-                result = thread->PutItem(workItem, level);
-            }else{
-                //创建新的线程执行任务
-                thread->Recycle();
-                thread = CreateThreadWorker(MakeThreadWorkerName(count)); //创建一个新的 ThreadWorker
-                if (thread == nullptr) {
-                    KFLOG_ERROR_T("%s -> InternalPutWorkItem: CreateThreadWorker Failed.", "GroupWorker");
-                    return KF_OUT_OF_MEMORY;
-                }
+public:
+    WorkerWatchdog() throw() : _ref_count(1) {}
+    virtual ~WorkerWatchdog() throw() {}
 
-                //启动这个线程的任务队列
-                thread->SetTimeout(WORKER_EXIT_TIMEOUT);
-                if (KF_FAILED(thread->TaskQueueStartup(false))) {
-                    KFLOG_ERROR_T("%s -> InternalPutWorkItem: TaskQueueStartup Failed.", "GroupWorker");
-                    thread->Recycle();
-                    return KF_INVALID_STATE;
-                }
+    KF_IMPL_RETAIN(_ref_count);
+    KF_IMPL_RECYCLE(_ref_count);
 
-                //提交任务
-                if (KF_FAILED(thread->PutItem(workItem, level))) {
-                    thread->TaskQueueShutdown();
-                    thread->Recycle();
-                    return KF_INVALID_STATE;
-                }
+    bool Start() throw() { return ThreadStart(nullptr, false, "KFAsyncWatchdog"); }
 
-                //把线程添加到组
-                result = _threads->AddElement(thread) ? KF_OK : KF_OUT_OF_MEMORY;
-            }
-            thread->Recycle();
-        }else{
-            KFLOG_T("%s -> InternalPutWorkItem: Select to ReserveThread.", "GroupWorker");
-            //如果线程已经饱和，则要提交到一个当前任务最少的线程
-            if (count == 1) {
-                //如果只允许创建一个 ThreadWorker
-                IKFAsyncThreadWorker_I* thread = nullptr;
-                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, 0,
-                                                               _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
-                                                               &thread);
-                if (thread) {
-                    result = thread->PutItem(workItem, level); //提交执行
-                    thread->Recycle();
+protected:
+    virtual void OnThreadInvoke(void*)
+    {
+        KFLOG_T("%s -> OnThreadInvoke Begin...", "WorkerWatchdog");
+        while (1) {
+            KFSleep(WORKER_WATCHDOG_INTERVAL);
+
+            //在锁外检查每个线程组（线程组的锁在 watchdog 的锁之前获取）
+            GroupWorker** groups = nullptr;
+            int count = 0;
+            {
+                KFMutex::AutoLock lock(kWatchdog_Mutex);
+                count = kWatchdog_Groups ? kWatchdog_Groups->GetElementCount() : 0;
+                if (count > 0)
+                    groups = (GroupWorker**)malloc(sizeof(GroupWorker*) * count);
+                if (groups == nullptr) {
+                    kWatchdog_Running = false;
+                    break;
                 }
-            }else{
-                //选一个任务最少的线程
-                IKFAsyncThreadWorker_I* thread = nullptr;
-                int exec_thread_index = -1;
-                
-                int cur_thread_index = 0;
-                int cur_thread_tasks = INT32_MAX;
                 for (int i = 0; i < count; i++) {
-                    KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, i,
-                                                                   _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
-                                                                   &thread);
-                    if (thread) {
-                        int task_count = thread->GetItemCount();
-                        if (task_count == 0) {
-                            exec_thread_index = i;
-                            thread->Recycle();
-                            break;
-                        }
-                        if (task_count < cur_thread_tasks) {
-                            cur_thread_tasks = task_count;
-                            cur_thread_index = i;
-                        }
-                        thread->Recycle();
-                    }
-                    exec_thread_index = cur_thread_index;
+                    IKFBaseObject* obj = nullptr;
+                    kWatchdog_Groups->GetElementNoRef(i, &obj);
+                    groups[i] = static_cast<GroupWorker*>(static_cast<IKFAsyncGroupWorker_I*>(obj));
+                    groups[i]->Retain();
                 }
-                
-                KFGetArrayListElement<IKFAsyncThreadWorker_I>(_threads, exec_thread_index,
-                                                               _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER,
-                                                               &thread);
-                result = thread->PutItem(workItem, level); //提交执行
-                thread->Recycle();
+            }
 
-                KFLOG_T("%s -> InternalPutWorkItem: Submit to Thread %d", "GroupWorker", exec_thread_index);
+            for (int i = 0; i < count; i++) {
+                groups[i]->CheckStalledThreads();
+                groups[i]->Recycle();
             }
+            free(groups);
         }
-        return result;
+        KFLOG_T("%s -> OnThreadInvoke Ended.", "WorkerWatchdog");
     }
+
+    virtual int OnThreadExit() { Recycle(); return 0; }
 };
 
+static void KFWatchdogRegister(GroupWorker* group)
+{
+    KFMutex::AutoLock lock(kWatchdog_Mutex);
+    if (kWatchdog_Groups == nullptr && KF_FAILED(KFCreateObjectArrayList(&kWatchdog_Groups)))
+        return;
+    if (!kWatchdog_Groups->AddElement(static_cast<IKFAsyncGroupWorker_I*>(group)))
+        return;
+
+    if (!kWatchdog_Running) {
+        auto watchdog = new(std::nothrow) WorkerWatchdog();
+        if (watchdog == nullptr)
+            return;
+        watchdog->Retain(); //线程持有一个引用，OnThreadExit 时释放
+        if (watchdog->Start())
+            kWatchdog_Running = true;
+        else
+            watchdog->Recycle();
+        watchdog->Recycle();
+    }
+}
+
+static void KFWatchdogUnregister(GroupWorker* group)
+{
+    KFMutex::AutoLock lock(kWatchdog_Mutex);
+    if (kWatchdog_Groups == nullptr)
+        return;
+    int count = kWatchdog_Groups->GetElementCount();
+    for (int i = 0; i < count; i++) {
+        IKFBaseObject* obj = nullptr;
+        kWatchdog_Groups->GetElementNoRef(i, &obj);
+        if (obj == static_cast<IKFAsyncGroupWorker_I*>(group)) {
+            kWatchdog_Groups->RemoveElement(i, nullptr);
+            break;
+        }
+    }
+}
+
 // ***************
 
 static KFMutex kGlobalDefaultQueue_Mutex;
@@ -752,16 +2619,42 @@ void KFAPI KFAsyncUnlockRef()
 struct AsyncWorkerObject
 {
     KREF RefCount;
-    GroupWorker* Worker;
+    IKFAsyncGroupWorker_I* Worker; //GroupWorker 或者 StrandWorker
     char* Name;
     int ThreadCount;
 };
+
+static AsyncWorkerObject* KFAsyncSelectWorker(KASYNCOBJECT worker)
+{
+    auto selector = worker;
+    if (worker == KF_ASYNC_GLOBAL_WORKER_SINGLE_THREAD)
+        selector = kGlobalDefaultQueue_Serial;
+    else if (worker == KF_ASYNC_GLOBAL_WORKER_MULTI_THREAD)
+        selector = kGlobalDefaultQueue_Parallel;
+    return reinterpret_cast<AsyncWorkerObject*>(selector);
+}
+#endif
+
+KF_RESULT KFAPI KFAsyncCreateWorker(bool parallel, int max_threads, KASYNCOBJECT* asyncObject, const char* worker_name, int idle_policy)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    KFAsyncWorkerConfig config = {};
+    config.Parallel = parallel;
+    config.MinThreads = 0;
+    config.MaxThreads = max_threads;
+    config.KeepAliveMs = KF_ASYNC_KEEP_ALIVE_DEFAULT;
+    config.IdlePolicy = idle_policy;
+    config.Name = worker_name;
+    return KFAsyncCreateWorkerEx(&config, asyncObject);
+#else
+    return KFAsyncCreateWorker_Win32_MF(parallel, max_threads, asyncObject, worker_name);
 #endif
+}
 
-KF_RESULT KFAPI KFAsyncCreateWorker(bool parallel, int max_threads, KASYNCOBJECT* asyncObject, const char* worker_name)
+KF_RESULT KFAPI KFAsyncCreateWorkerEx(const KFAsyncWorkerConfig* config, KASYNCOBJECT* asyncObject)
 {
 #ifndef KF_WIN_MF_WORKQUEUE
-    if (asyncObject == nullptr)
+    if (config == nullptr || asyncObject == nullptr)
         return KF_INVALID_PTR;
 
     auto object = (AsyncWorkerObject*)malloc(sizeof(AsyncWorkerObject));
@@ -776,12 +2669,13 @@ KF_RESULT KFAPI KFAsyncCreateWorker(bool parallel, int max_threads, KASYNCOBJECT
     }
     
     //启动第一个线程体
-    auto name = worker_name;
-    if (name)
-        if (strlen(name) == 1)
-            name = nullptr;
+    auto worker_config = *config;
+    if (worker_config.Name)
+        if (strlen(worker_config.Name) == 1)
+            worker_config.Name = nullptr;
 
-    if (KF_FAILED(worker->Startup(parallel ? max_threads : 1, name))) {
+    if (KF_FAILED(worker->Startup(&worker_config))) {
+        worker->Shutdown();
         worker->Recycle();
         free(object);
         return KF_INIT_ERROR;
@@ -789,15 +2683,67 @@ KF_RESULT KFAPI KFAsyncCreateWorker(bool parallel, int max_threads, KASYNCOBJECT
 
     object->RefCount = 1;
     object->Worker = worker;
-    object->ThreadCount = max_threads;
+    object->ThreadCount = config->MaxThreads;
     object->Name = nullptr;
-    if (worker_name)
-        object->Name = strdup(worker_name);
+    if (config->Name)
+        object->Name = strdup(config->Name);
     
     *asyncObject = object;
     return KF_OK;
 #else
-    return KFAsyncCreateWorker_Win32_MF(parallel, max_threads, asyncObject, worker_name);
+    if (config == nullptr)
+        return KF_INVALID_PTR;
+    return KFAsyncCreateWorker_Win32_MF(config->Parallel, config->MaxThreads, asyncObject, config->Name);
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncCreateStrand(KASYNCOBJECT pool, KASYNCOBJECT* strand, const char* strand_name)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (strand == nullptr)
+        return KF_INVALID_PTR;
+
+    auto host = KFAsyncSelectWorker(pool ? pool : KF_ASYNC_GLOBAL_WORKER_MULTI_THREAD);
+    if (host == nullptr)
+        return KF_INVALID_STATE; //还没有 KFAsyncStartup
+
+    auto object = (AsyncWorkerObject*)malloc(sizeof(AsyncWorkerObject));
+    if (object == nullptr)
+        return KF_OUT_OF_MEMORY;
+
+    auto worker = new(std::nothrow) StrandWorker(host, host->Worker);
+    if (worker == nullptr) {
+        free(object);
+        return KF_OUT_OF_MEMORY;
+    }
+    worker->Startup(nullptr);
+
+    object->RefCount = 1;
+    object->Worker = worker;
+    object->ThreadCount = 1;
+    object->Name = nullptr;
+    if (strand_name)
+        object->Name = strdup(strand_name);
+
+    *strand = object;
+    return KF_OK;
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPrewarmWorker(KASYNCOBJECT worker, int threads)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr || threads <= 0)
+        return KF_INVALID_ARG;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    return my->Worker->Prewarm(threads);
+#else
+    return KF_NOT_SUPPORTED;
 #endif
 }
 
@@ -897,22 +2843,276 @@ KF_RESULT KFAPI KFAsyncGetWorkerName(KASYNCOBJECT worker, char* worker_name, int
 KF_RESULT KFAPI KFAsyncPutWorkItemEx(KASYNCOBJECT worker, IKFAsyncResult* result)
 {
 #ifndef KF_WIN_MF_WORKQUEUE
-    if (worker == nullptr || result == nullptr)
+    return KFAsyncPutWorkItemWithPriority(worker, result, KF_ASYNC_PRIORITY_NORMAL);
+#else
+    return KFAsyncPutWorkItemEx_Win32_MF(worker, result);
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutWorkItemWithPriority(KASYNCOBJECT worker, IKFAsyncResult* result, int priority)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    KFAsyncWorkItemOptions options = {};
+    options.Priority = priority;
+    return KFAsyncPutWorkItemWithOptions(worker, result, &options);
+#else
+    return KFAsyncPutWorkItemEx_Win32_MF(worker, result); //MF 工作队列不支持优先级
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutWorkItemWithOptions(KASYNCOBJECT worker, IKFAsyncResult* result, const KFAsyncWorkItemOptions* options)
+{
+    if (worker == nullptr || result == nullptr || options == nullptr)
         return KF_INVALID_ARG;
-    
-    auto selector = worker;
-    if (worker == KF_ASYNC_GLOBAL_WORKER_SINGLE_THREAD)
-        selector = kGlobalDefaultQueue_Serial;
-    else if (worker == KF_ASYNC_GLOBAL_WORKER_MULTI_THREAD)
-        selector = kGlobalDefaultQueue_Parallel;
+    if (options->Priority < 0 || options->Priority >= KF_ASYNC_PRIORITY_LEVELS || options->DeadlineMs < 0)
+        return KF_INVALID_ARG;
+    if (options->CancelToken && options->CancelToken->IsCancelled())
+        return KF_ABORT; //已经取消的令牌不用再提交
 
-    auto my = reinterpret_cast<AsyncWorkerObject*>(selector);
-    return my->Worker->PutWorkItem(result, false);
+#ifndef KF_WIN_MF_WORKQUEUE
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    return my->Worker->PutWorkItem(result, options);
 #else
+    if (options->CancelToken || options->DeadlineMs != KF_ASYNC_DEADLINE_NONE)
+        return KF_NOT_SUPPORTED; //MF 工作队列提交以后不能再丢弃任务
     return KFAsyncPutWorkItemEx_Win32_MF(worker, result);
 #endif
 }
 
+KF_RESULT KFAPI KFAsyncCreateCancelToken(IKFAsyncCancelToken** token)
+{
+    if (token == nullptr)
+        return KF_INVALID_PTR;
+
+    auto t = new(std::nothrow) AsyncCancelToken();
+    if (t == nullptr)
+        return KF_OUT_OF_MEMORY;
+
+    *token = t;
+    return KF_OK;
+}
+
+KF_RESULT KFAPI KFAsyncGetWorkerDropStats(KASYNCOBJECT worker, KFAsyncDropStats* stats)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr)
+        return KF_INVALID_ARG;
+    if (stats == nullptr)
+        return KF_INVALID_PTR;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    memset(stats, 0, sizeof(KFAsyncDropStats));
+    my->Worker->GetDropStats(stats);
+    return KF_OK;
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutWorkFunction(KASYNCOBJECT worker, KFAsyncWorkFunc func, void* context)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr || func == nullptr)
+        return KF_INVALID_ARG;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    return my->Worker->PutWorkFunction(func, context, KF_ASYNC_PRIORITY_NORMAL);
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutNoDropFunction(KASYNCOBJECT worker, KFAsyncWorkFunc func, KFAsyncWorkFunc discard, void* context)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr || func == nullptr || discard == nullptr)
+        return KF_INVALID_ARG;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    return my->Worker->PutDrainFunction(func, discard, context, KF_ASYNC_PRIORITY_NORMAL);
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutInlineFunction(KASYNCOBJECT worker, const KFAsyncInlineFuncOps* ops, void* source, int priority)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr || ops == nullptr || ops->Construct == nullptr || ops->Invoke == nullptr || ops->Destroy == nullptr)
+        return KF_INVALID_ARG;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    return my->Worker->PutInlineFunction(ops, source, priority);
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutWorkItemBatch(KASYNCOBJECT worker, IKFAsyncResult** results, int count)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr || results == nullptr || count <= 0)
+        return KF_INVALID_ARG;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    return my->Worker->PutWorkItems(results, count, KF_ASYNC_PRIORITY_NORMAL);
+#else
+    if (worker == nullptr || results == nullptr || count <= 0)
+        return KF_INVALID_ARG;
+    for (int i = 0; i < count; i++)
+        _KF_FAILED_RET(KFAsyncPutWorkItemEx_Win32_MF(worker, results[i]));
+    return KF_OK;
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncPutWorkItemBatchCallbacks(KASYNCOBJECT worker, IKFAsyncCallback** callbacks, IKFBaseObject** states, int count)
+{
+    if (worker == nullptr || callbacks == nullptr || count <= 0)
+        return KF_INVALID_ARG;
+
+    auto results = (IKFAsyncResult**)calloc(count, sizeof(IKFAsyncResult*));
+    if (results == nullptr)
+        return KF_OUT_OF_MEMORY;
+
+    KF_RESULT r = KF_OK;
+    for (int i = 0; i < count; i++) {
+        r = KFAsyncCreateResult(callbacks[i], states ? states[i] : nullptr, nullptr, &results[i]);
+        if (KF_FAILED(r))
+            break;
+    }
+    if (KF_SUCCEEDED(r))
+        r = KFAsyncPutWorkItemBatch(worker, results, count);
+
+    for (int i = 0; i < count; i++)
+        if (results[i])
+            results[i]->Recycle();
+    free(results);
+    return r;
+}
+
+KF_RESULT KFAPI KFAsyncGetWorkerIdleStats(KASYNCOBJECT worker, KFAsyncIdleStats* stats)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr)
+        return KF_INVALID_ARG;
+    if (stats == nullptr)
+        return KF_INVALID_PTR;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    memset(stats, 0, sizeof(KFAsyncIdleStats));
+    my->Worker->GetIdleStats(stats);
+    return KF_OK;
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+int KFAsyncGetWorkerConcurrency(KASYNCOBJECT worker)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr)
+        return 0;
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return 0;
+    return my->Worker->GetMaxThreads();
+#else
+    return KFSystemCpuCount();
+#endif
+}
+
+KF_RESULT KFAPI KFAsyncGetWorkerQueueDepth(KASYNCOBJECT worker, int priority, int* depth)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr)
+        return KF_INVALID_ARG;
+    if (depth == nullptr)
+        return KF_INVALID_PTR;
+    if (priority != KF_ASYNC_PRIORITY_ALL && (priority < 0 || priority >= KF_ASYNC_PRIORITY_LEVELS))
+        return KF_INVALID_ARG;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    *depth = my->Worker->GetQueueDepth(priority);
+    return KF_OK;
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
+bool KFAPI KFAsyncWorkerWouldBlock(KASYNCOBJECT worker, int count)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr || count <= 0)
+        return false;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return false;
+    return my->Worker->WouldBlock(count);
+#else
+    return false;
+#endif
+}
+
+#ifndef KF_WIN_MF_WORKQUEUE
+//根据等待时间直方图估算百分位：返回所在桶的上界（不超过最大值）
+static KF_INT64 KFAsyncStatsWaitPercentile(const KFAsyncWorkerStats* stats, int percent)
+{
+    KF_INT64 total = 0;
+    for (int i = 0; i < KF_ASYNC_STATS_WAIT_BUCKETS; i++)
+        total += stats->WaitHistogram[i];
+    if (total == 0)
+        return 0;
+
+    KF_INT64 target = (total * percent + 99) / 100;
+    KF_INT64 sum = 0;
+    for (int i = 0; i < KF_ASYNC_STATS_WAIT_BUCKETS; i++) {
+        sum += stats->WaitHistogram[i];
+        if (sum >= target)
+            return _KF_MIN(((KF_INT64)1) << (i + 1), stats->WaitMaxUs);
+    }
+    return stats->WaitMaxUs;
+}
+#endif
+
+KF_RESULT KFAPI KFAsyncGetWorkerStats(KASYNCOBJECT worker, KFAsyncWorkerStats* stats)
+{
+#ifndef KF_WIN_MF_WORKQUEUE
+    if (worker == nullptr)
+        return KF_INVALID_ARG;
+    if (stats == nullptr)
+        return KF_INVALID_PTR;
+
+    auto my = KFAsyncSelectWorker(worker);
+    if (my == nullptr)
+        return KF_INVALID_STATE;
+    memset(stats, 0, sizeof(KFAsyncWorkerStats));
+    my->Worker->GetStats(stats);
+    stats->WaitP50Us = KFAsyncStatsWaitPercentile(stats, 50);
+    stats->WaitP90Us = KFAsyncStatsWaitPercentile(stats, 90);
+    stats->WaitP99Us = KFAsyncStatsWaitPercentile(stats, 99);
+    return KF_OK;
+#else
+    return KF_NOT_SUPPORTED;
+#endif
+}
+
 KF_RESULT KFAPI KFAsyncPutWorkItem(KASYNCOBJECT worker, IKFAsyncCallback* callback, IKFBaseObject* state)
 {
 #ifndef KF_WIN_MF_WORKQUEUE
@@ -0,0 +1,211 @@
+﻿#ifndef __KF_ASYNC__ASYNC_COROUTINE_H
+#define __KF_ASYNC__ASYNC_COROUTINE_H
+
+#include <async/kf_async_abstract.hxx>
+#include <async/kf_async_event.hxx>
+#include <async/kf_timed_event.hxx>
+#include <base/kf_ptr.hxx>
+
+//C++20 协程的 awaitable 适配（编译器不支持协程时这个头文件为空）
+#if (__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)) && __has_include(<coroutine>)
+#define KF_ASYNC_COROUTINE_SUPPORTED 1
+
+#include <atomic>
+#include <coroutine>
+
+//co_await KFAsyncSchedule(worker)：挂起当前协程，在 worker 的线程上恢复
+//通过 KFAsyncPutNoDropFunction 提交，除了内存池中的 WorkItem 没有别的分配；提交失败时在当前线程立即恢复并返回错误，
+//提交以后 Worker 关闭丢弃了任务时，在丢弃的线程上恢复并返回 KF_SHUTDOWN
+class KFAsyncScheduleAwaiter
+{
+public:
+    explicit KFAsyncScheduleAwaiter(KASYNCOBJECT worker) throw() : _worker(worker), _result(KF_OK) {}
+    KF_DISALLOW_COPY_AND_ASSIGN(KFAsyncScheduleAwaiter)
+
+    bool await_ready() const throw() { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) throw()
+    {
+        //提交成功以后协程随时可能在别的线程恢复，不能再访问 this
+        _handle = handle;
+        auto r = KFAsyncPutNoDropFunction(_worker, &ResumeProc, &DiscardProc, this);
+        if (KF_SUCCEEDED(r))
+            return true;
+        _result = r;
+        return false;
+    }
+    KF_RESULT await_resume() const throw() { return _result; }
+
+private:
+    static void ResumeProc(void* context)
+    { static_cast<KFAsyncScheduleAwaiter*>(context)->_handle.resume(); }
+    static void DiscardProc(void* context)
+    {
+        auto self = static_cast<KFAsyncScheduleAwaiter*>(context);
+        self->_result = KF_SHUTDOWN;
+        self->_handle.resume();
+    }
+
+    KASYNCOBJECT _worker;
+    std::coroutine_handle<> _handle;
+    KF_RESULT _result;
+};
+
+//回调型 awaiter 的公共部分：awaiter 在协程帧里，自己作为回调对象交给异步组件，不需要额外分配
+//引用计数降到 0（异步组件已经释放了所有引用）时才把协程提交到目标 Worker 恢复，之后不再访问 this
+class KFAsyncCoroutineResumer
+{
+protected:
+    explicit KFAsyncCoroutineResumer(KASYNCOBJECT worker, KF_RESULT released_result) throw() :
+        _worker(worker), _refs(1), _result(released_result) {}
+    KF_DISALLOW_COPY_AND_ASSIGN(KFAsyncCoroutineResumer)
+
+    KREF AddRef() throw() { return _refs.fetch_add(1, std::memory_order_relaxed) + 1; }
+    KREF Release() throw()
+    {
+        KREF rc = _refs.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (rc == 0)
+            ResumeOnWorker();
+        return rc;
+    }
+
+    //异步操作已经开始：放弃自己持有的引用，返回 true 表示协程保持挂起
+    bool Suspend(KF_RESULT start_result) throw()
+    {
+        if (KF_FAILED(start_result)) {
+            _result = start_result;
+            return false;
+        }
+        Release();
+        return true;
+    }
+
+private:
+    void ResumeOnWorker() throw()
+    {
+        if (KF_FAILED(KFAsyncPutNoDropFunction(_worker, &ResumeProc, &DiscardProc, this)))
+            DiscardProc(this); //目标 Worker 已经关闭，只能在当前线程恢复
+    }
+    static void ResumeProc(void* context)
+    { static_cast<KFAsyncCoroutineResumer*>(context)->_handle.resume(); }
+    static void DiscardProc(void* context) //提交失败或者提交以后被 Worker 丢弃
+    {
+        auto self = static_cast<KFAsyncCoroutineResumer*>(context);
+        self->_result = KF_SHUTDOWN;
+        self->_handle.resume();
+    }
+
+protected:
+    KASYNCOBJECT _worker;
+    std::coroutine_handle<> _handle;
+    std::atomic<KREF> _refs;
+    KF_RESULT _result;
+};
+
+//co_await KFAsyncNextEvent(queue, worker) 的返回值
+struct KFAsyncEventAwaitResult
+{
+    KF_RESULT Result;
+    KFPtr<IKFAsyncEvent> Event; //Result 失败时为空
+};
+
+//co_await KFAsyncNextEvent(queue, worker)：等待事件队列的下一个事件（BeginGetEvent/EndGetEvent），在 worker 的线程上恢复
+//事件队列关闭时返回 KF_SHUTDOWN
+class KFAsyncNextEventAwaiter : public IKFAsyncCallback, protected KFAsyncCoroutineResumer
+{
+public:
+    KFAsyncNextEventAwaiter(IKFAsyncEventQueue* queue, KASYNCOBJECT worker) throw() :
+        KFAsyncCoroutineResumer(worker, KF_SHUTDOWN), _queue(queue), _event(nullptr) {}
+    virtual ~KFAsyncNextEventAwaiter() throw() { if (_event) _event->Recycle(); }
+
+    bool await_ready() const throw() { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) throw()
+    {
+        if (_queue == nullptr || _worker == nullptr)
+            return Suspend(KF_INVALID_ARG);
+        _handle = handle;
+        return Suspend(_queue->BeginGetEvent(this, nullptr));
+    }
+    KFAsyncEventAwaitResult await_resume() throw()
+    {
+        KFAsyncEventAwaitResult r;
+        r.Result = _result;
+        r.Event.Attach(_event);
+        _event = nullptr;
+        return r;
+    }
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_ASYNC_CALLBACK)) {
+            *ppv = static_cast<IKFAsyncCallback*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+    virtual KREF Retain() { return AddRef(); }
+    virtual KREF Recycle() { return Release(); }
+
+    //在事件队列的线程上执行，取出事件以后等最后一个引用释放时再恢复协程
+    virtual void Execute(IKFAsyncResult*) { _result = _queue->EndGetEvent(&_event); }
+
+private:
+    IKFAsyncEventQueue* _queue;
+    IKFAsyncEvent* _event;
+};
+
+//co_await KFAsyncDelay(queue, delay_ms, worker)：通过定时事件队列等待 delay_ms，在 worker 的线程上恢复
+//事件被取消或者队列关闭时返回 KF_ABORT
+class KFAsyncDelayAwaiter : public IKFTimedEventCallback, protected KFAsyncCoroutineResumer
+{
+public:
+    KFAsyncDelayAwaiter(IKFTimedEventQueue* queue, KF_INT32 delay_ms, KASYNCOBJECT worker) throw() :
+        KFAsyncCoroutineResumer(worker, KF_ABORT), _queue(queue), _delay_ms(delay_ms) {}
+    virtual ~KFAsyncDelayAwaiter() throw() {}
+
+    bool await_ready() const throw() { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) throw()
+    {
+        if (_queue == nullptr || _worker == nullptr)
+            return Suspend(KF_INVALID_ARG);
+        _handle = handle;
+        return Suspend(KFPutTimedEventCallbackWithDelay(_queue, this, nullptr, _delay_ms));
+    }
+    KF_RESULT await_resume() const throw() { return _result; }
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_TIMED_EVENT_CALLBACK)) {
+            *ppv = static_cast<IKFTimedEventCallback*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+    virtual KREF Retain() { return AddRef(); }
+    virtual KREF Recycle() { return Release(); }
+
+    virtual void Invoke(IKFTimedEventState*, IKFBaseObject*) { _result = KF_OK; }
+
+private:
+    IKFTimedEventQueue* _queue;
+    KF_INT32 _delay_ms;
+};
+
+// ***** Helpers ***** //
+
+inline KFAsyncScheduleAwaiter KFAsyncSchedule(KASYNCOBJECT worker) throw()
+{ return KFAsyncScheduleAwaiter(worker); }
+inline KFAsyncNextEventAwaiter KFAsyncNextEvent(IKFAsyncEventQueue* queue, KASYNCOBJECT worker) throw()
+{ return KFAsyncNextEventAwaiter(queue, worker); }
+inline KFAsyncDelayAwaiter KFAsyncDelay(IKFTimedEventQueue* queue, KF_INT32 delay_ms, KASYNCOBJECT worker) throw()
+{ return KFAsyncDelayAwaiter(queue, delay_ms, worker); }
+
+#endif
+#endif //__KF_ASYNC__ASYNC_COROUTINE_H
\ No newline at end of file
@@ -5,14 +5,16 @@
 #include <async/kf_async_abstract.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_ASYNC_EVENT "kf_iid_async_event"
-#define _KF_INTERFACE_ID_ASYNC_EVENT_QUEUE "kf_iid_async_event_queue"
+#define _KF_INTERFACE_ID_ASYNC_EVENT _KF_IID("kf_iid_async_event")
+#define _KF_INTERFACE_ID_ASYNC_EVENT_QUEUE _KF_IID("kf_iid_async_event_queue")
 #else
-#define _KF_INTERFACE_ID_ASYNC_EVENT "4131764C95C647FFB92A0178BF4F78A4"
-#define _KF_INTERFACE_ID_ASYNC_EVENT_QUEUE "30F38DBD723F4AFDB859A53498927B85"
+#define _KF_INTERFACE_ID_ASYNC_EVENT _KF_IID("4131764C95C647FFB92A0178BF4F78A4")
+#define _KF_INTERFACE_ID_ASYNC_EVENT_QUEUE _KF_IID("30F38DBD723F4AFDB859A53498927B85")
 #endif 
 
 #define KF_ASYNC_EVENT_TIMEOUT_INFINITE -1
+//IKFAsyncEventQueue::Startup 的 flags
+#define KF_ASYNC_EVENT_QUEUE_FLAG_STRAND 0x1 //BeginGetEvent 的回调在全局并行 Worker 上的 Strand 中执行，不为每个队列创建线程
 
 struct IKFAsyncEvent : public IKFAttributes
 {
@@ -17,15 +17,18 @@ class AsyncEventQueue : public IKFAsyncEventQueue
     KASYNCOBJECT _exec_thread;
     AsyncCallbackRouter<AsyncEventQueue> _callback;
     bool _closed, _waiting;
+    bool _use_strand; //KF_ASYNC_EVENT_QUEUE_FLAG_STRAND：回调不能阻塞 Strand 的线程，等到有事件才提交
+    IKFAsyncResult* _pending_result; //Strand 模式下还在等待事件的 BeginGetEvent
 
     KFMutex _mutex;
 
 public:
     AsyncEventQueue() throw() :
-    _ref_count(1), _event_queue(nullptr), _wake_queue_event(nullptr), _exec_thread(nullptr)
+    _ref_count(1), _event_queue(nullptr), _wake_queue_event(nullptr), _exec_thread(nullptr), _use_strand(false), _pending_result(nullptr)
     { _callback.SetCallback(this, &AsyncEventQueue::OnInvoke); }
     virtual ~AsyncEventQueue() throw()
     {
+        if (_pending_result) _pending_result->Recycle();
         if (_exec_thread) KFAsyncDestroyWorker(_exec_thread);
         if (_wake_queue_event) KFEventDestroy(_wake_queue_event);
         if (_event_queue) _event_queue->Recycle();
@@ -50,7 +53,7 @@ public:
     { KF_IMPL_RECYCLE_FUNC(_ref_count); }
 
 public:
-    virtual KF_RESULT Startup(KF_UINT32)
+    virtual KF_RESULT Startup(KF_UINT32 flags)
     {
         KFMutex::AutoLock lock(_mutex);
 
@@ -73,6 +76,9 @@ public:
 
         _closed = false;
         _waiting = false;
+        _use_strand = (flags & KF_ASYNC_EVENT_QUEUE_FLAG_STRAND) != 0;
+        if (_use_strand)
+            return KFAsyncCreateStrand(nullptr, &_exec_thread);
         return KFAsyncCreateWorker(false, 1, &_exec_thread);
     }
 
@@ -82,6 +88,10 @@ public:
         if (_event_queue)
             _event_queue->Clear();
         _closed = true;
+        if (_pending_result) { //和线程模式一样，关闭以后不再调用等待中的回调
+            _pending_result->Recycle();
+            _pending_result = nullptr;
+        }
 
         if (_wake_queue_event) {
             KFLOG_T("%s -> Shutdown: Wake Queue Event to Exit.", "AsyncEventQueue");
@@ -173,6 +183,12 @@ public:
         auto r = KFAsyncCreateResult(&_callback, state, callback, &async_result);
         _KF_FAILED_RET(r);
 
+        if (_use_strand && _event_queue->GetCount() == 0) {
+            _pending_result = async_result; //QueueEvent 的时候再提交
+            _waiting = true;
+            return KF_OK;
+        }
+
         r = KFAsyncPutWorkItemEx(_exec_thread, async_result);
         async_result->Recycle();
         _KF_FAILED_RET(r);
@@ -232,6 +248,14 @@ public:
         KFLOG_T("%s -> QueueEvent: WAKE Event Queue... (Type: %d)", "AsyncEventQueue", pEvent->GetEventType());
 
         KFEventSet(_wake_queue_event);
+        if (_pending_result) {
+            auto pending = _pending_result;
+            _pending_result = nullptr;
+            auto r = KFAsyncPutWorkItemEx(_exec_thread, pending);
+            pending->Recycle();
+            if (KF_FAILED(r))
+                KFLOG_ERROR_T("%s -> QueueEvent: Put pending callback Failed.", "AsyncEventQueue");
+        }
         return KF_OK;
     }
 
@@ -290,7 +314,7 @@ public:
         }
         KFLOG_T("%s -> AsyncEventQueue::OnInvoke (wait?) : %s.", "AsyncEventQueue", to_wait ? "True" : "False");
 
-        if (to_wait)
+        if (to_wait && !_use_strand) //Strand 模式只在有事件的时候提交
             KFEventWait(_wake_queue_event);
         else
             KFEventReset(_wake_queue_event);
@@ -299,6 +323,12 @@ public:
         KF_RESULT event_result = KF_OK;
         {
             KFMutex::AutoLock lock(_mutex);
+            if (_use_strand && !_closed && _event_queue->GetCount() == 0) {
+                //事件已经被 GetEvent 取走，继续等待下一个事件
+                result->Retain();
+                _pending_result = result;
+                return;
+            }
             if (_closed || _event_queue->GetCount() == 0)
                 return;
             else
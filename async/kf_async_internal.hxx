@@ -1,13 +1,14 @@
 ﻿#ifndef __KF_ASYNC__ASYNC_INTERNAL_H
 #define __KF_ASYNC__ASYNC_INTERNAL_H
 
+#include <atomic>
 #include <async/kf_async_abstract.hxx>
 #include <base/kf_array_list.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT "__kf_iid_async_result"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT _KF_IID("__kf_iid_async_result")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT "_9DB9CAEA7B3B4CFCAB58C63FFE6AC86F"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_RESULT _KF_IID("_9DB9CAEA7B3B4CFCAB58C63FFE6AC86F")
 #endif
 struct IKFAsyncResult_I : public IKFAsyncResult
 {
@@ -16,57 +17,109 @@ struct IKFAsyncResult_I : public IKFAsyncResult
 };
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_WORK_ITEM "__kf_iid_async_work_item"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_WORK_ITEM _KF_IID("__kf_iid_async_work_item")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_WORK_ITEM "_2AC68D7B300342CE9AFD5F97E5E8BE41"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_WORK_ITEM _KF_IID("_2AC68D7B300342CE9AFD5F97E5E8BE41")
 #endif
+struct IKFAsyncWorkItem_I;
+struct KFAsyncQueueNode //ThreadWorker 无锁任务队列的侵入式节点，嵌在每个 WorkItem 中
+{
+    std::atomic<KFAsyncQueueNode*> Next;
+    IKFAsyncWorkItem_I* Item;
+};
+
 struct IKFAsyncWorkItem_I : public IKFBaseObject
 {
     enum WorkItemState
     {
         ExecuteTask, //执行 IKFAsyncResult 中的 IKFAsyncCallback->Invoke
-        RequestExit  //退出 当前的 ThreadWorker
+        RequestExit, //退出 当前的 ThreadWorker
+        ExecuteFunction //执行 KFAsyncPutWorkFunction 提交的函数（没有 IKFAsyncResult）
     };
     virtual WorkItemState GetItemState() = 0;
     virtual bool GetAsyncResult(IKFAsyncResult_I** result) = 0; //取得 Callback 方法
+    virtual IKFAsyncResult_I* PeekAsyncResult() = 0; //不增加引用计数，WorkItem 存在期间有效（执行任务时使用）
+    virtual void InvokeFunction() = 0; //ExecuteFunction 类型的 WorkItem 直接执行
+
+    enum DropReason
+    {
+        NotDropped,
+        DropCancelled, //取消令牌已经被 Cancel
+        DropExpired //超过了提交时指定的期限
+    };
+    virtual DropReason CheckDrop() = 0; //执行之前检查，没有关联令牌和期限时不读取时间
+    virtual int GetPriority() = 0; //提交时的优先级（任务被偷走或者移动时保持不变）
+    virtual KF_INT64 GetEnqueueTime() = 0; //提交的时刻（单调时钟，微秒）
+    virtual KFAsyncQueueNode* GetQueueNode() = 0; //入队时不需要再分配节点
+    virtual bool IsOverflowExempt() = 0; //不会被 KF_ASYNC_OVERFLOW_DROP_OLDEST 丢弃（Strand 的 Drain）
+    virtual void OnDiscarded() = 0; //没有执行就被丢弃（Worker 关闭、取消、超过期限）时调用，提交者借此释放相关的状态
 };
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER "__kf_iid_async_thread_worker"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER _KF_IID("__kf_iid_async_thread_worker")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER "_9038CCA5588542278BC86CE88A393EAA"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_THREAD_WORKER _KF_IID("_9038CCA5588542278BC86CE88A393EAA")
 #endif
 struct IKFAsyncThreadWorker_I : public IKFBaseObject
 {
-    enum WorkItemPriority //优先级
+    enum WorkItemPriority //优先级（每个优先级有独立的 FIFO 队列，和 KF_ASYNC_PRIORITY_* 一一对应）
     {
-        WorkItemLevel0, //最低优先级，插到队列尾
-        WorkItemLevel1, //中等优先级，插到队列中间
-        WorkItemLevel2  //最高优先级，插到队列头
+        WorkItemLevel0, //最低优先级
+        WorkItemLevel1, //普通优先级
+        WorkItemLevel2, //高优先级
+        WorkItemLevel3, //最高优先级（实时）
+        WorkItemLevelCount
     };
     virtual KF_RESULT TaskQueueStartup(bool delayRunThread) = 0; //运行这个线程的任务队列
     virtual KF_RESULT TaskQueueShutdown() = 0; //关闭任务队列
     virtual KF_RESULT PutItem(IKFAsyncWorkItem_I* asyncItem, WorkItemPriority level) = 0; //提交任务到队列
+    virtual KF_RESULT PutItems(IKFAsyncWorkItem_I** asyncItems, int count, WorkItemPriority level) = 0; //一次提交一批任务（只通知一次线程）
     virtual int GetItemCount() = 0;
+    virtual int GetLevelItemCount(WorkItemPriority level) = 0; //取得某个优先级队列中待执行的任务数
     virtual void SetTimeout(int timeout_ms) = 0;
+    virtual void SetIdlePolicy(int idle_policy) = 0; //KF_ASYNC_IDLE_*
+    virtual bool Prewarm() = 0; //没有运行的线程立即启动（然后进入空闲等待）
+    virtual void GetIdleStats(KFAsyncIdleStats* stats) = 0; //把本线程的统计累加到 stats
+    virtual void GetDropStats(KFAsyncDropStats* stats) = 0; //把本线程丢弃的任务数累加到 stats
+    virtual void GetExecStats(KFAsyncWorkerStats* stats) = 0; //把本线程的执行统计累加到 stats（不包括线程数和队列长度）
     virtual int GetExecuteElapsedTime() = 0; //取得当前执行中的任务已经执行了多久(ms)
     
     virtual bool IsTaskQueueMoved() = 0; //判断自己的任务队列是不是已经被移走
     virtual void MoveCurrentTaskQueue(IKFAsyncThreadWorker_I* other) = 0; //把自己的任务队列移到别的Worker
     virtual bool AcceptTaskQueueMove(IKFAsyncThreadWorker_I* other, IKFArrayList* queue) = 0; //接受从别的Worker过来的任务队列
+
+    virtual bool IsIdle() = 0; //线程是否空闲（没有执行中的任务并且任务队列为空）
+    virtual int StealItems(IKFAsyncThreadWorker_I* thief) = 0; //把自己一半的待执行任务交给空闲的 thief 线程，返回被偷走的任务数
+    virtual bool DropOldestItem() = 0; //丢弃最低优先级队列的第一个任务（KF_ASYNC_OVERFLOW_DROP_OLDEST）
 };
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_GROUP_WORKER "__kf_iid_async_group_worker"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_GROUP_WORKER _KF_IID("__kf_iid_async_group_worker")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_ASYNC_GROUP_WORKER "_B7815B51E4FF4FCA873549F1F8FD013D"
+#define _INTERNAL_KF_INTERFACE_ID_ASYNC_GROUP_WORKER _KF_IID("_B7815B51E4FF4FCA873549F1F8FD013D")
 #endif
 struct IKFAsyncGroupWorker_I : public IKFBaseObject
 {
-    virtual KF_RESULT Startup(int max_threads, const char* name) = 0; //启动第一个 ThreadWorker 对象
+    virtual KF_RESULT Startup(const KFAsyncWorkerConfig* config) = 0; //启动第一个（或者 MinThreads 个）ThreadWorker 对象
     virtual KF_RESULT Shutdown() = 0; //关闭所有 ThreadWorker 对象
-    virtual KF_RESULT PutWorkItem(IKFAsyncResult* result, bool realtime) = 0; //realtime 表示是否插到队列头
+    virtual KF_RESULT PutWorkItem(IKFAsyncResult* result, const KFAsyncWorkItemOptions* options) = 0;
+    virtual KF_RESULT PutWorkItems(IKFAsyncResult** results, int count, int priority) = 0; //批量提交，并行的 Worker 会分散到多个线程
+    virtual KF_RESULT PutWorkFunction(KFAsyncWorkFunc func, void* context, int priority) = 0; //提交函数指针，不创建 IKFAsyncResult
+    virtual KF_RESULT PutInlineFunction(const KFAsyncInlineFuncOps* ops, void* source, int priority) = 0; //可调用对象存放在 WorkItem 里
+    //Strand 的 Drain：总是排到队列尾部，不走本线程的 LIFO 槽，也不在提交的线程上执行；不会因为溢出被丢弃，Worker 关闭丢弃时调用 discard
+    virtual KF_RESULT PutDrainFunction(KFAsyncWorkFunc func, KFAsyncWorkFunc discard, void* context, int priority) = 0;
     virtual int GetCurrentThreads() = 0;
+    virtual int GetMaxThreads() = 0; //最多可以同时执行的任务数
+    virtual KF_RESULT Prewarm(int threads) = 0; //立即启动 threads 个线程
+    virtual void GetIdleStats(KFAsyncIdleStats* stats) = 0; //所有线程的空闲等待统计
+    virtual void GetDropStats(KFAsyncDropStats* stats) = 0; //所有线程丢弃的任务数
+    virtual void GetStats(KFAsyncWorkerStats* stats) = 0; //所有线程的运行统计（不计算百分位）
+    virtual int GetQueueDepth(int priority) = 0; //所有线程中某个优先级（或者 KF_ASYNC_PRIORITY_ALL）待执行的任务数
+    virtual bool StealWorkItems(IKFAsyncThreadWorker_I* thief) = 0; //空闲的 ThreadWorker 从组内最忙的线程偷任务
+    virtual bool WouldBlock(int count) = 0; //再提交 count 个任务是否会超过容量
 };
 
+//Worker 最多可以同时执行的任务数（无上限的 Worker 按照 CPU 核心数计算）
+int KFAsyncGetWorkerConcurrency(KASYNCOBJECT worker);
+
 #endif //__KF_ASYNC__ASYNC_INTERNAL_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+﻿#include <atomic>
+#include <base/kf_base.hxx>
+#include <base/kf_log.hxx>
+#include <async/kf_async_internal.hxx>
+#include <async/kf_async_parallel.hxx>
+
+#define KF_LOG_TAG_STR "kf_async_parallel.cxx"
+
+#define PARALLEL_CHUNKS_PER_THREAD 4 //自动切分时每个线程分到的段数
+#define PARALLEL_MAX_HELPERS 64 //最多提交到 Worker 的辅助任务数
+
+class ParallelJob : public IKFAsyncCallback
+{
+    KF_IMPL_DECL_REFCOUNT;
+
+    KFAsyncParallelRangeFunc _func;
+    void* _context;
+    KF_INT64 _begin, _end, _grain, _chunks;
+
+    std::atomic<KF_INT64> _next_chunk; //下一个待领取的段
+    std::atomic<KF_INT64> _done_chunks; //已经执行完的段
+    void* _done_event; //最后一段执行完时通知调用线程
+
+public:
+    ParallelJob(KFAsyncParallelRangeFunc func, void* context, KF_INT64 begin, KF_INT64 end, KF_INT64 grain) throw() :
+        _ref_count(1), _func(func), _context(context), _begin(begin), _end(end), _grain(grain),
+        _next_chunk(0), _done_chunks(0), _done_event(nullptr)
+    { _chunks = (end - begin + grain - 1) / grain; }
+    virtual ~ParallelJob() throw()
+    { if (_done_event) KFEventDestroy(_done_event); }
+
+    bool Init() throw()
+    { _done_event = KFEventCreate(0, 1); return _done_event != nullptr; }
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_ASYNC_CALLBACK)) {
+            *ppv = static_cast<IKFAsyncCallback*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+
+    virtual KREF Retain()
+    { KF_IMPL_RETAIN_FUNC(_ref_count); }
+    virtual KREF Recycle()
+    { KF_IMPL_RECYCLE_FUNC(_ref_count); }
+
+public:
+    virtual void Execute(IKFAsyncResult*) { RunChunks(); }
+
+    KF_INT64 GetChunkCount() const throw() { return _chunks; }
+
+    //领取并执行段，直到没有剩下的段（所有段领取完以后不会再访问 _func/_context）
+    void RunChunks() throw()
+    {
+        while (1) {
+            KF_INT64 chunk = _next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= _chunks)
+                break;
+
+            KF_INT64 chunk_begin = _begin + chunk * _grain;
+            KF_INT64 chunk_end = _KF_MIN(chunk_begin + _grain, _end);
+            _func(_context, chunk_begin, chunk_end);
+            if (_done_chunks.fetch_add(1, std::memory_order_acq_rel) + 1 == _chunks)
+                KFEventSet(_done_event);
+        }
+    }
+
+    //调用线程等待已经被别的线程领取的段执行完
+    void WaitForDone() throw()
+    {
+        if (_done_chunks.load(std::memory_order_acquire) < _chunks)
+            KFEventWait(_done_event);
+    }
+};
+
+// ***************
+
+KF_RESULT KFAPI KFAsyncParallelForRange(KASYNCOBJECT worker, KF_INT64 begin, KF_INT64 end, KF_INT64 grain,
+                                        KFAsyncParallelRangeFunc func, void* context)
+{
+    if (worker == nullptr || func == nullptr || grain < 0)
+        return KF_INVALID_ARG;
+    if (begin >= end)
+        return KF_OK;
+
+    int threads = KFAsyncGetWorkerConcurrency(worker);
+    if (threads <= 0)
+        return KF_INVALID_STATE;
+
+    KF_INT64 count = end - begin;
+    if (grain == KF_ASYNC_PARALLEL_GRAIN_AUTO) {
+        //Worker 的线程加上调用线程，每个线程大约分到 PARALLEL_CHUNKS_PER_THREAD 段
+        KF_INT64 chunks = (KF_INT64)(threads + 1) * PARALLEL_CHUNKS_PER_THREAD;
+        grain = _KF_MAX((count + chunks - 1) / chunks, 1);
+    }
+
+    //只有一段，不需要分发
+    if (grain >= count) {
+        func(context, begin, end);
+        return KF_OK;
+    }
+
+    auto job = new(std::nothrow) ParallelJob(func, context, begin, end, grain);
+    if (job == nullptr)
+        return KF_OUT_OF_MEMORY;
+    if (!job->Init()) {
+        job->Recycle();
+        return KF_INIT_ERROR;
+    }
+
+    //调用线程自己执行一段，剩下的段最多分给 threads 个辅助任务
+    KF_INT64 helpers = _KF_MIN(job->GetChunkCount() - 1, (KF_INT64)_KF_MIN(threads, PARALLEL_MAX_HELPERS));
+    IKFAsyncCallback* callbacks[PARALLEL_MAX_HELPERS];
+    for (KF_INT64 i = 0; i < helpers; i++)
+        callbacks[i] = job;
+    if (helpers > 0 && KF_FAILED(KFAsyncPutWorkItemBatchCallbacks(worker, callbacks, nullptr, (int)helpers)))
+        KFLOG_WARN_T("%s -> Submit helpers failed, run on caller thread.", "KFAsyncParallelForRange");
+
+    job->RunChunks();
+    job->WaitForDone();
+    job->Recycle();
+    return KF_OK;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+﻿#ifndef __KF_ASYNC__ASYNC_PARALLEL_H
+#define __KF_ASYNC__ASYNC_PARALLEL_H
+
+#include <async/kf_async_abstract.hxx>
+#include <utils/auto_mutex.hxx>
+
+#define KF_ASYNC_PARALLEL_GRAIN_AUTO 0 //按照 Worker 的线程数自动切分（每个线程大约 4 段）
+
+//对 [begin, end) 中的每一段 [chunk_begin, chunk_end) 调用 func，调用线程也参与执行，全部执行完才返回
+//切分成 grain 大小的段，由空闲的线程动态领取（快的线程领取得多），整个过程只分配一个任务对象
+typedef void (*KFAsyncParallelRangeFunc)(void* context, KF_INT64 chunk_begin, KF_INT64 chunk_end);
+KF_RESULT KFAPI KFAsyncParallelForRange(KASYNCOBJECT worker, KF_INT64 begin, KF_INT64 end, KF_INT64 grain,
+                                        KFAsyncParallelRangeFunc func, void* context);
+
+// ***** Helpers ***** //
+
+//fn(KF_INT64 index)：对 [begin, end) 中的每一个下标调用一次
+template<typename Fn>
+inline KF_RESULT KFAsyncParallelFor(KASYNCOBJECT worker, KF_INT64 begin, KF_INT64 end, KF_INT64 grain, const Fn& fn)
+{
+    struct Thunk
+    {
+        static void Invoke(void* context, KF_INT64 chunk_begin, KF_INT64 chunk_end)
+        {
+            auto& f = *static_cast<const Fn*>(context);
+            for (KF_INT64 i = chunk_begin; i < chunk_end; i++)
+                f(i);
+        }
+    };
+    return KFAsyncParallelForRange(worker, begin, end, grain, &Thunk::Invoke, const_cast<Fn*>(&fn));
+}
+
+//map(KF_INT64 index) -> T，combine(T, T) -> T
+//每一段先在本线程内归并，段的结果再归并到 *result（combine 需要满足结合律和交换律）
+template<typename T, typename Map, typename Combine>
+inline KF_RESULT KFAsyncParallelReduce(KASYNCOBJECT worker, KF_INT64 begin, KF_INT64 end, KF_INT64 grain,
+                                       const T& identity, const Map& map, const Combine& combine, T* result)
+{
+    if (result == nullptr)
+        return KF_INVALID_PTR;
+
+    struct Context
+    {
+        const T* Identity;
+        const Map* MapFunc;
+        const Combine* CombineFunc;
+        T* Result;
+        KFSpinLock Lock;
+
+        static void Invoke(void* context, KF_INT64 chunk_begin, KF_INT64 chunk_end)
+        {
+            auto ctx = static_cast<Context*>(context);
+            T partial = *ctx->Identity;
+            for (KF_INT64 i = chunk_begin; i < chunk_end; i++)
+                partial = (*ctx->CombineFunc)(partial, (*ctx->MapFunc)(i));
+
+            KFSpinLock::AutoLock lock(ctx->Lock);
+            *ctx->Result = (*ctx->CombineFunc)(*ctx->Result, partial);
+        }
+    };
+
+    *result = identity;
+    Context context;
+    context.Identity = &identity;
+    context.MapFunc = &map;
+    context.CombineFunc = &combine;
+    context.Result = result;
+    return KFAsyncParallelForRange(worker, begin, end, grain, &Context::Invoke, &context);
+}
+
+#endif //__KF_ASYNC__ASYNC_PARALLEL_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+﻿#ifndef __KF_ASYNC__ASYNC_POST_H
+#define __KF_ASYNC__ASYNC_POST_H
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <async/kf_async_abstract.hxx>
+
+//KFAsyncPost(worker, [=] { ... })：提交一个 lambda（或者任何可以无参数调用的对象）执行，不需要实现 IKFAsyncCallback
+//捕获的内容不超过 KF_ASYNC_INLINE_FUNC_SIZE 时直接构造在内存池的 WorkItem 里，不创建 IKFAsyncResult，提交只有一次入队
+//超过的部分单独分配一次；没有执行就被丢弃（Worker 销毁、队列溢出等）时只析构，不调用
+template<typename Fn>
+struct KFAsyncInlineFunc
+{
+    static const bool kIsInline = sizeof(Fn) <= KF_ASYNC_INLINE_FUNC_SIZE && alignof(Fn) <= alignof(std::max_align_t);
+
+    template<typename F>
+    static bool Construct(void* storage, void* source)
+    {
+        auto& fn = *static_cast<typename std::remove_reference<F>::type*>(source);
+        if (kIsInline) {
+            new(storage) Fn(std::forward<F>(fn));
+            return true;
+        }
+        auto p = new(std::nothrow) Fn(std::forward<F>(fn));
+        *static_cast<Fn**>(storage) = p;
+        return p != nullptr;
+    }
+    static void Invoke(void* storage)
+    { (*Get(storage))(); }
+    static void Destroy(void* storage)
+    {
+        if (kIsInline)
+            Get(storage)->~Fn();
+        else
+            delete Get(storage);
+    }
+
+    static Fn* Get(void* storage) throw()
+    { return kIsInline ? static_cast<Fn*>(storage) : *static_cast<Fn**>(storage); }
+
+    template<typename F>
+    static const KFAsyncInlineFuncOps* GetOps() throw()
+    {
+        static const KFAsyncInlineFuncOps ops = {&Construct<F>, &Invoke, &Destroy};
+        return &ops;
+    }
+};
+
+template<typename F>
+inline KF_RESULT KFAsyncPost(KASYNCOBJECT worker, F&& fn, int priority = KF_ASYNC_PRIORITY_NORMAL)
+{
+    typedef typename std::decay<F>::type Fn;
+    return KFAsyncPutInlineFunction(worker, KFAsyncInlineFunc<Fn>::template GetOps<F&&>(),
+                                    const_cast<void*>(static_cast<const void*>(&fn)), priority);
+}
+
+#endif //__KF_ASYNC__ASYNC_POST_H
\ No newline at end of file
@@ -1,10 +1,12 @@
 ﻿#include <utils/auto_mutex.hxx>
+#include <utils/object_pool.hxx>
 #include <base/kf_base.hxx>
 #include <async/kf_async_internal.hxx>
 
 class AsyncResult : public IKFAsyncResult_I
 {
     KF_IMPL_DECL_REFCOUNT;
+    KF_IMPL_OBJECT_POOL(AsyncResult); //每次提交任务都会创建，从内存池分配
 
     IKFAsyncCallback* _callback;
 
@@ -12,7 +14,7 @@ class AsyncResult : public IKFAsyncResult_I
     IKFBaseObject* _object;
     IKFBaseObject* _state;
 
-    KFMutex _mutex;
+    KFSpinLock _lock; //只保护指针的读写，不需要创建系统锁对象
 
 public:
     AsyncResult(KF_RESULT result, IKFBaseObject* object, IKFBaseObject* state) throw() :
@@ -43,27 +45,29 @@ public:
 public:
     virtual void SetResult(KF_RESULT result)
     {
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         _result = result;
     }
 
     virtual void SetObject(IKFBaseObject* pObject)
     {
-        KFMutex::AutoLock lock(_mutex);
-        if (_object != nullptr) {
-            _object->Recycle();
-            _object = nullptr;
-        }
-
-        if (pObject != nullptr) {
+        if (pObject != nullptr)
             pObject->Retain();
+
+        IKFBaseObject* old;
+        {
+            KFSpinLock::AutoLock lock(_lock);
+            old = _object;
             _object = pObject;
         }
+        //在锁外释放旧的对象：Recycle 可能执行析构，析构中再访问这个 AsyncResult 会在不可重入的自旋锁上死锁
+        if (old != nullptr)
+            old->Recycle();
     }
 
     virtual KF_RESULT GetResult()
     {
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         return _result;
     }
 
@@ -72,7 +76,7 @@ public:
         if (ppState == nullptr)
             return KF_INVALID_PTR;
 
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         if (_state == nullptr)
             return KF_NOT_FOUND;
 
@@ -86,7 +90,7 @@ public:
         if (ppObject == nullptr)
             return KF_INVALID_PTR;
 
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         if (_object == nullptr)
             return KF_NOT_FOUND;
 
@@ -97,29 +101,34 @@ public:
 
     virtual IKFBaseObject* GetStateNoRef()
     {
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         return _state;
     }
 
     virtual IKFBaseObject* GetObjectNoRef()
     {
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         return _object;
     }
 
 public:
     virtual void SetCallback(IKFAsyncCallback* callback)
     {
-        KFMutex::AutoLock lock(_mutex);
-        if (_callback)
-            _callback->Recycle();
-        _callback = callback;
-        _callback->Retain();
+        callback->Retain();
+
+        IKFAsyncCallback* old;
+        {
+            KFSpinLock::AutoLock lock(_lock);
+            old = _callback;
+            _callback = callback;
+        }
+        if (old) //同 SetObject，在锁外释放
+            old->Recycle();
     }
 
     virtual void GetCallback(IKFAsyncCallback** callback)
     {
-        KFMutex::AutoLock lock(_mutex);
+        KFSpinLock::AutoLock lock(_lock);
         *callback = _callback;
         _callback->Retain();
     }
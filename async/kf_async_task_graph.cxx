@@ -0,0 +1,392 @@
+﻿#include <atomic>
+#include <stdlib.h>
+#include <base/kf_base.hxx>
+#include <base/kf_log.hxx>
+#include <utils/auto_mutex.hxx>
+#include <async/kf_async_internal.hxx>
+#include <async/kf_async_task_graph.hxx>
+
+#define KF_LOG_TAG_STR "kf_async_task_graph.cxx"
+
+class AsyncTaskGraph;
+
+//图中的一个任务，作为 Callback 提交到 Worker，引用计数转发给所在的图（任务排队期间图不会被释放）
+class TaskNode : public IKFAsyncCallback
+{
+    friend class AsyncTaskGraph;
+
+    AsyncTaskGraph* _graph;
+    IKFAsyncCallback* _callback;
+    IKFBaseObject* _state;
+
+    KF_ASYNC_TASK_ID* _successors;
+    int _successor_count, _successor_capacity;
+    int _predecessor_count; //Launch 以后不再改变
+    std::atomic<int> _pending; //还没有执行完的前驱数，减到 0 的线程负责提交这个任务
+    TaskNode* _next_ready; //就绪链表（只在把 _pending 减到 0 的线程上使用，每个任务只就绪一次）
+
+public:
+    TaskNode(AsyncTaskGraph* graph, IKFAsyncCallback* callback, IKFBaseObject* state) throw() :
+        _graph(graph), _callback(callback), _state(state),
+        _successors(nullptr), _successor_count(0), _successor_capacity(0),
+        _predecessor_count(0), _pending(0), _next_ready(nullptr)
+    {
+        _callback->Retain();
+        if (_state)
+            _state->Retain();
+    }
+    virtual ~TaskNode() throw()
+    {
+        _callback->Recycle();
+        if (_state)
+            _state->Recycle();
+        if (_successors)
+            free(_successors);
+    }
+
+    bool AddSuccessor(KF_ASYNC_TASK_ID id) throw()
+    {
+        if (_successor_count == _successor_capacity) {
+            int capacity = _successor_capacity == 0 ? 4 : _successor_capacity * 2;
+            auto p = (KF_ASYNC_TASK_ID*)realloc(_successors, sizeof(KF_ASYNC_TASK_ID) * capacity);
+            if (p == nullptr)
+                return false;
+            _successors = p;
+            _successor_capacity = capacity;
+        }
+        _successors[_successor_count++] = id;
+        return true;
+    }
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_ASYNC_CALLBACK)) {
+            *ppv = static_cast<IKFAsyncCallback*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+
+    virtual KREF Retain();
+    virtual KREF Recycle();
+
+    virtual void Execute(IKFAsyncResult* result);
+
+    //通过 KFAsyncPutNoDropFunction 提交时的入口，context 是 TaskNode（提交时持有图的引用）
+    static void RunProc(void* context);
+    static void DiscardProc(void* context);
+};
+
+class AsyncTaskGraph : public IKFAsyncTaskGraph
+{
+    KF_IMPL_DECL_REFCOUNT;
+
+    KFMutex _mutex; //只保护 AddTask/Launch，执行过程中不加锁
+    TaskNode** _nodes;
+    int _count, _capacity;
+    bool _launched;
+
+    KASYNCOBJECT _worker;
+    IKFAsyncCallback* _completion;
+    IKFBaseObject* _completion_state;
+
+    std::atomic<int> _remaining; //还没有执行完的任务数
+    std::atomic<int> _result; //有任务被 Worker 丢弃以后不再是 KF_OK，剩下的任务不再执行
+    std::atomic<bool> _completed;
+    void* _done_event; //只给 WaitForCompletion 使用
+
+public:
+    AsyncTaskGraph() throw() :
+        _ref_count(1), _nodes(nullptr), _count(0), _capacity(0), _launched(false),
+        _worker(nullptr), _completion(nullptr), _completion_state(nullptr),
+        _remaining(0), _result(KF_OK), _completed(false), _done_event(nullptr) {}
+    virtual ~AsyncTaskGraph() throw()
+    {
+        for (int i = 0; i < _count; i++)
+            delete _nodes[i];
+        if (_nodes)
+            free(_nodes);
+        if (_completion)
+            _completion->Recycle();
+        if (_completion_state)
+            _completion_state->Recycle();
+        if (_done_event)
+            KFEventDestroy(_done_event);
+    }
+
+    bool Init() throw()
+    { _done_event = KFEventCreate(0, 1); return _done_event != nullptr; }
+
+public:
+    virtual KF_RESULT CastToInterface(KIID interface_id, void** ppv)
+    {
+        KF_IMPL_CHECK_PARAM;
+        if (_KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_BASE_OBJECT) ||
+            _KFInterfaceIdEqual(interface_id, _KF_INTERFACE_ID_ASYNC_TASK_GRAPH)) {
+            *ppv = static_cast<IKFAsyncTaskGraph*>(this);
+            Retain();
+            return KF_OK;
+        }
+        return KF_NO_INTERFACE;
+    }
+
+    virtual KREF Retain()
+    { KF_IMPL_RETAIN_FUNC(_ref_count); }
+    virtual KREF Recycle()
+    { KF_IMPL_RECYCLE_FUNC(_ref_count); }
+
+public:
+    virtual KF_RESULT AddTask(IKFAsyncCallback* callback, IKFBaseObject* state,
+                              const KF_ASYNC_TASK_ID* predecessors, int count, KF_ASYNC_TASK_ID* id)
+    {
+        if (callback == nullptr || count < 0 || (count > 0 && predecessors == nullptr))
+            return KF_INVALID_ARG;
+
+        KFMutex::AutoLock lock(_mutex);
+        if (_launched)
+            return KF_INVALID_STATE;
+        //前驱只能是已经存在的任务，这样添加的顺序就是一个拓扑序，不会出现环
+        for (int i = 0; i < count; i++)
+            if (predecessors[i] < 0 || predecessors[i] >= _count)
+                return KF_NOT_FOUND;
+
+        if (_count == _capacity) {
+            int capacity = _capacity == 0 ? 16 : _capacity * 2;
+            auto p = (TaskNode**)realloc(_nodes, sizeof(TaskNode*) * capacity);
+            if (p == nullptr)
+                return KF_OUT_OF_MEMORY;
+            _nodes = p;
+            _capacity = capacity;
+        }
+
+        auto node = new(std::nothrow) TaskNode(this, callback, state);
+        if (node == nullptr)
+            return KF_OUT_OF_MEMORY;
+        for (int i = 0; i < count; i++) {
+            if (!_nodes[predecessors[i]]->AddSuccessor(_count)) {
+                for (int j = 0; j < i; j++)
+                    _nodes[predecessors[j]]->_successor_count--; //撤销已经加上的边
+                delete node;
+                return KF_OUT_OF_MEMORY;
+            }
+        }
+        node->_predecessor_count = count;
+        node->_pending.store(count, std::memory_order_relaxed);
+
+        _nodes[_count] = node;
+        if (id)
+            *id = _count;
+        _count++;
+        return KF_OK;
+    }
+
+    virtual int GetTaskCount()
+    { KFMutex::AutoLock lock(_mutex); return _count; }
+
+    virtual KF_RESULT Launch(KASYNCOBJECT worker, IKFAsyncCallback* completion, IKFBaseObject* state)
+    {
+        if (worker == nullptr)
+            return KF_INVALID_ARG;
+
+        TaskNode* ready = nullptr;
+        int rootCount = 0;
+        {
+            KFMutex::AutoLock lock(_mutex);
+            if (_launched)
+                return KF_INVALID_STATE;
+
+            _launched = true;
+            _worker = worker;
+            _completion = completion;
+            _completion_state = state;
+            if (_completion)
+                _completion->Retain();
+            if (_completion_state)
+                _completion_state->Retain();
+            _remaining.store(_count, std::memory_order_relaxed);
+
+            //先把所有的起始任务串成就绪链表（按照添加的顺序）再提交，提交以后 _pending 随时会被别的线程修改
+            for (int i = _count - 1; i >= 0; i--) {
+                if (_nodes[i]->_predecessor_count == 0) {
+                    _nodes[i]->_next_ready = ready;
+                    ready = _nodes[i];
+                    rootCount++;
+                }
+            }
+        }
+        KFLOG_T("%s -> Launch: %d Tasks, %d Roots.", "AsyncTaskGraph", _count, rootCount);
+
+        if (_count == 0)
+            OnGraphDone();
+        SubmitReadyTasks(ready);
+        return KF_OK;
+    }
+
+    virtual bool IsCompleted()
+    { return _completed.load(std::memory_order_acquire); }
+
+    virtual KF_RESULT WaitForCompletion(int timeout_ms)
+    {
+        {
+            KFMutex::AutoLock lock(_mutex);
+            if (!_launched)
+                return KF_INVALID_STATE;
+        }
+        if (timeout_ms < 0)
+            KFEventWait(_done_event);
+        else if (KFEventWaitTimed(_done_event, timeout_ms) == KF_EVENT_TIME_OUT)
+            return KF_TIMEOUT;
+        return (KF_RESULT)_result.load(std::memory_order_acquire);
+    }
+
+public:
+    //任务执行完以后在工作线程上调用：前驱计数减到 0 的后继任务立即提交
+    void OnTaskDone(TaskNode* node) throw()
+    {
+        TaskNode* ready = nullptr;
+        CompleteTask(node, &ready);
+        SubmitReadyTasks(ready);
+    }
+
+    //任务没有执行就被 Worker 丢弃（Worker 关闭）：图以错误结束，后继任务只推进计数，不再执行
+    void OnTaskDiscarded(TaskNode* node, KF_RESULT reason) throw()
+    {
+        KFLOG_WARN_T("%s -> OnTaskDiscarded: Task Dropped by Worker (%d).", "AsyncTaskGraph", reason);
+        int expected = KF_OK;
+        _result.compare_exchange_strong(expected, reason, std::memory_order_acq_rel);
+        OnTaskDone(node);
+    }
+
+private:
+    //一个任务结束：前驱计数减到 0 的后继任务加到 ready 链表，全部任务结束时完成整个图
+    void CompleteTask(TaskNode* node, TaskNode** ready) throw()
+    {
+        for (int i = 0; i < node->_successor_count; i++) {
+            auto next = _nodes[node->_successors[i]];
+            if (next->_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                next->_next_ready = *ready;
+                *ready = next;
+            }
+        }
+        if (_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            OnGraphDone();
+    }
+
+    //提交就绪链表里的任务：提交不了的任务（图已经失败、Worker 已经关闭或者内存不足）在当前线程结束，
+    //它们的后继任务加到同一个链表，在这个循环里处理，所以很长的依赖链也不会递归
+    void SubmitReadyTasks(TaskNode* ready) throw()
+    {
+        while (ready) {
+            auto node = ready;
+            ready = node->_next_ready;
+            node->_next_ready = nullptr;
+
+            //前面的任务已经被丢弃时只推进计数，不再执行
+            if (_result.load(std::memory_order_acquire) == KF_OK) {
+                auto r = SubmitTask(node);
+                if (KF_SUCCEEDED(r))
+                    continue;
+
+                //提交失败也要继续推进，否则后继任务和 completion 永远不会执行
+                KFLOG_ERROR_T("%s -> SubmitTask: PutWorkItem Failed (%d), Run on Current Thread.", "AsyncTaskGraph", r);
+                IKFAsyncResult* result = nullptr;
+                if (KF_SUCCEEDED(KFAsyncCreateResult(node, node->_state, nullptr, &result))) {
+                    node->_callback->Execute(result);
+                    result->Recycle();
+                }
+            }
+            CompleteTask(node, &ready);
+        }
+    }
+
+    KF_RESULT SubmitTask(TaskNode* node) throw()
+    {
+        //不会被 KF_ASYNC_OVERFLOW_DROP_OLDEST 丢弃，Worker 关闭时丢弃会调用 DiscardProc，所以每个任务都会推进计数
+        Retain();
+        auto r = KFAsyncPutNoDropFunction(_worker, &TaskNode::RunProc, &TaskNode::DiscardProc, node);
+        if (KF_SUCCEEDED(r))
+            return r;
+        Recycle();
+        if (r == KF_NOT_SUPPORTED)
+            r = KFAsyncPutWorkItem(_worker, node, node->_state);
+        return r;
+    }
+
+    void OnGraphDone() throw()
+    {
+        KFLOG_T("%s -> OnGraphDone.", "AsyncTaskGraph");
+        _completed.store(true, std::memory_order_release);
+        auto graph_result = (KF_RESULT)_result.load(std::memory_order_acquire);
+        if (_completion && graph_result == KF_OK) {
+            if (KF_FAILED(KFAsyncPutWorkItem(_worker, _completion, _completion_state)))
+                KFLOG_ERROR_T("%s -> OnGraphDone: Submit Completion Failed.", "AsyncTaskGraph");
+        }else if (_completion) {
+            //有任务被丢弃：Worker 已经关闭（KASYNCOBJECT 可能已经无效），在当前线程执行 completion，GetResult 返回丢弃的原因
+            IKFAsyncResult* result = nullptr;
+            if (KF_SUCCEEDED(KFAsyncCreateResult(_completion, _completion_state, nullptr, &result))) {
+                result->SetResult(graph_result);
+                _completion->Execute(result);
+                result->Recycle();
+            }else{
+                KFLOG_ERROR_T("%s -> OnGraphDone: Create Completion Result Failed.", "AsyncTaskGraph");
+            }
+        }
+        KFEventSet(_done_event);
+    }
+};
+
+KREF TaskNode::Retain()
+{ return _graph->Retain(); }
+KREF TaskNode::Recycle()
+{ return _graph->Recycle(); }
+
+void TaskNode::Execute(IKFAsyncResult* result)
+{
+    _callback->Execute(result);
+    _graph->OnTaskDone(this);
+}
+
+void TaskNode::RunProc(void* context)
+{
+    auto node = static_cast<TaskNode*>(context);
+    auto graph = node->_graph;
+    IKFAsyncResult* result = nullptr;
+    auto r = KFAsyncCreateResult(node, node->_state, nullptr, &result);
+    if (KF_SUCCEEDED(r)) {
+        node->Execute(result);
+        result->Recycle();
+    }else{
+        graph->OnTaskDiscarded(node, r);
+    }
+    graph->Recycle(); //SubmitTask 的引用
+}
+
+void TaskNode::DiscardProc(void* context)
+{
+    auto node = static_cast<TaskNode*>(context);
+    auto graph = node->_graph;
+    graph->OnTaskDiscarded(node, KF_SHUTDOWN);
+    graph->Recycle();
+}
+
+// ***************
+
+KF_RESULT KFAPI KFCreateAsyncTaskGraph(IKFAsyncTaskGraph** graph)
+{
+    if (graph == nullptr)
+        return KF_INVALID_PTR;
+
+    auto g = new(std::nothrow) AsyncTaskGraph();
+    if (g == nullptr)
+        return KF_OUT_OF_MEMORY;
+    if (!g->Init()) {
+        g->Recycle();
+        return KF_INIT_ERROR;
+    }
+    *graph = g;
+    return KF_OK;
+}
\ No newline at end of file
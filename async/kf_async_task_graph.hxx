@@ -0,0 +1,37 @@
+﻿#ifndef __KF_ASYNC__ASYNC_TASK_GRAPH_H
+#define __KF_ASYNC__ASYNC_TASK_GRAPH_H
+
+#include <async/kf_async_abstract.hxx>
+
+typedef int KF_ASYNC_TASK_ID;
+
+#define KF_ASYNC_TASK_ID_INVALID -1
+
+#ifndef KF_INTERFACE_ID_USE_GUID
+#define _KF_INTERFACE_ID_ASYNC_TASK_GRAPH _KF_IID("kf_iid_async_task_graph")
+#else
+#define _KF_INTERFACE_ID_ASYNC_TASK_GRAPH _KF_IID("5C0E6F2B8A0D4C7E9B3A61D2F4E8C915")
+#endif
+//任务依赖图：每个任务声明自己的前驱任务，前驱全部执行完以后才会被提交到 Worker
+//每个任务有一个原子的依赖计数，最后一个前驱执行完的线程负责提交后继任务，任何工作线程都不会阻塞等待
+struct IKFAsyncTaskGraph : public IKFBaseObject
+{
+    //添加任务，predecessors 只能是已经添加过的任务（所以图一定没有环），state 会作为 IKFAsyncResult 的 State
+    virtual KF_RESULT AddTask(IKFAsyncCallback* callback, IKFBaseObject* state,
+                              const KF_ASYNC_TASK_ID* predecessors, int count, KF_ASYNC_TASK_ID* id) = 0;
+    virtual int GetTaskCount() = 0;
+
+    //开始执行（只能调用一次，之后不能再添加任务），没有前驱的任务立即提交到 worker
+    //completion 可以为 nullptr，否则全部任务执行完以后会提交到同一个 worker 执行
+    //任务不会因为 KF_ASYNC_OVERFLOW_DROP_OLDEST 被丢弃；worker 关闭丢弃了任务时，剩下的任务不再执行，
+    //completion 在丢弃任务的线程上执行，它的 IKFAsyncResult::GetResult 和 WaitForCompletion 返回 KF_SHUTDOWN
+    virtual KF_RESULT Launch(KASYNCOBJECT worker, IKFAsyncCallback* completion, IKFBaseObject* state) = 0;
+
+    virtual bool IsCompleted() = 0;
+    //等待全部任务执行完（timeout_ms < 0 表示一直等待），只能在 worker 之外的线程调用，工作线程应该使用 completion
+    virtual KF_RESULT WaitForCompletion(int timeout_ms) = 0;
+};
+
+KF_RESULT KFAPI KFCreateAsyncTaskGraph(IKFAsyncTaskGraph** graph);
+
+#endif //__KF_ASYNC__ASYNC_TASK_GRAPH_H
\ No newline at end of file
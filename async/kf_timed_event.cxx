@@ -1,4 +1,6 @@
-﻿#include <utils/auto_mutex.hxx>
+﻿#include <string.h>
+#include <stdlib.h>
+#include <utils/auto_mutex.hxx>
 #include <base/kf_log.hxx>
 #include <base/kf_ptr.hxx>
 #include <async/kf_thread_object.hxx>
@@ -10,12 +12,301 @@
 #pragma warning(disable:4127)
 #endif
 
+//定时事件的最小堆：按 (期望时间, 提交序号) 排序，期望时间相同的事件按提交顺序执行
+//另外用一个 id -> 堆下标 的开放寻址哈希表，Post/Cancel/按 ID 移除都是 O(log n)，不需要遍历
+//不是线程安全的，由 TimedEventQueue 的 _mutex 保护
+class TimedEventHeap
+{
+    struct Entry
+    {
+        KF_INT64 Time;
+        KF_INT64 Latest; //最晚的执行时间（Time + slack）
+        KF_UINT64 Seq;
+        KF_TIMED_EVENT_ID Id;
+        IKFTimedEventState_I* State; //持有一个引用
+    };
+    struct Slot
+    {
+        KF_TIMED_EVENT_ID Id; //TIMED_QUEUE_INVALID_EVENT_ID 表示空位
+        int Index;
+    };
+
+    Entry* _heap;
+    int _count, _capacity;
+    int _slack_count; //Latest > Time 的事件数，为 0 时合并唤醒的时间就是堆顶的期望时间
+    KF_UINT64 _seq;
+
+    Slot* _slots;
+    int _slot_mask; //容量 - 1（容量是 2 的幂）
+
+public:
+    TimedEventHeap() throw() :
+    _heap(nullptr), _count(0), _capacity(0), _slack_count(0), _seq(0),
+    _slots(nullptr), _slot_mask(-1) {}
+    ~TimedEventHeap() throw()
+    {
+        Clear();
+        if (_heap)
+            free(_heap);
+        if (_slots)
+            free(_slots);
+    }
+
+    KF_DISALLOW_COPY_AND_ASSIGN(TimedEventHeap)
+
+public:
+    int GetCount() const throw() { return _count; }
+    bool IsEmpty() const throw() { return _count == 0; }
+
+    IKFTimedEventState_I* GetTop() const throw() //不增加引用
+    { return _count > 0 ? _heap[0].State : nullptr; }
+
+    bool Contains(KF_TIMED_EVENT_ID id) const throw()
+    { return FindSlot(id) >= 0; }
+
+    //合并唤醒的时间：所有 期望时间 <= 结果 的事件中，最晚执行时间的最小值
+    //在这个时间醒来可以一次执行完这些事件，并且每个事件都没有超出自己的时间窗口
+    //期望时间更大的事件不会让结果变小，所以只需要访问堆顶附近期望时间不超过结果的那部分
+    KF_INT64 GetCoalescedDeadline() const throw()
+    {
+        if (_count == 0)
+            return INT64_MAX;
+        KF_INT64 limit = _heap[0].Latest;
+        if (_slack_count > 0) //都没有 slack 时不需要遍历（同一时间的大量事件会让遍历变成 O(k)）
+            CollectLatest(0, &limit);
+        return limit;
+    }
+
+    IKFTimedEventState_I* Find(KF_TIMED_EVENT_ID id) const throw() //不增加引用
+    {
+        int slot = FindSlot(id);
+        return slot >= 0 ? _heap[_slots[slot].Index].State : nullptr;
+    }
+
+    //修改事件的期望时间（原地调整位置，ID 不变），排序上等同于重新提交
+    bool Update(KF_TIMED_EVENT_ID id, KF_INT64 time) throw()
+    {
+        int slot = FindSlot(id);
+        if (slot < 0)
+            return false;
+
+        int index = _slots[slot].Index;
+        Entry e = _heap[index];
+        e.Latest = time + (e.Latest - e.Time); //slack 不变
+        e.Time = time;
+        e.Seq = _seq++;
+        if (index > 0 && Less(e, _heap[(index - 1) / 2]))
+            SiftUp(index, e);
+        else
+            SiftDown(index, e);
+        return true;
+    }
+
+    //is_top 返回新事件是不是成为了堆顶（最早要执行的事件）
+    bool Push(IKFTimedEventState_I* state, KF_TIMED_EVENT_ID id, KF_INT64 time, KF_INT64 latest, bool* is_top) throw()
+    {
+        if (!ReserveHeap(_count + 1) || !ReserveSlots(_count + 1))
+            return false;
+
+        Entry e;
+        e.Time = time;
+        e.Latest = latest;
+        e.Seq = _seq++;
+        e.Id = id;
+        e.State = state;
+        state->Retain();
+        if (latest > time)
+            _slack_count++;
+
+        InsertSlot(id, _count);
+        int index = SiftUp(_count++, e);
+        if (is_top)
+            *is_top = (index == 0);
+        return true;
+    }
+
+    //从堆中移除，事件的引用交给 state（state 为 nullptr 时直接释放），was_top 返回移除的是不是堆顶
+    bool Remove(KF_TIMED_EVENT_ID id, IKFTimedEventState_I** state, bool* was_top) throw()
+    {
+        int slot = FindSlot(id);
+        if (slot < 0)
+            return false;
+
+        int index = _slots[slot].Index;
+        EraseSlot(slot);
+
+        auto s = _heap[index].State;
+        if (_heap[index].Latest > _heap[index].Time)
+            _slack_count--;
+        if (was_top)
+            *was_top = (index == 0);
+
+        _count--;
+        if (index != _count) { //用最后一个元素填补空位，然后向上或者向下调整
+            Entry last = _heap[_count];
+            if (index > 0 && Less(last, _heap[(index - 1) / 2]))
+                SiftUp(index, last);
+            else
+                SiftDown(index, last);
+        }
+
+        if (state)
+            *state = s;
+        else
+            s->Recycle();
+        return true;
+    }
+
+    void Clear() throw()
+    {
+        for (int i = 0; i < _count; i++)
+            _heap[i].State->Recycle();
+        _count = 0;
+        _slack_count = 0;
+        if (_slots)
+            memset(_slots, 0, sizeof(Slot) * (_slot_mask + 1));
+    }
+
+private:
+    static bool Less(const Entry& a, const Entry& b) throw()
+    { return a.Time < b.Time || (a.Time == b.Time && a.Seq < b.Seq); }
+
+    static unsigned HashId(KF_TIMED_EVENT_ID id) throw()
+    { return (unsigned)id * 2654435761u; } //ID 是连续递增的，乘一个奇数打散到整个表
+
+    void CollectLatest(int index, KF_INT64* limit) const throw()
+    {
+        if (index >= _count || _heap[index].Time > *limit)
+            return; //子树中的期望时间都更大
+        if (_heap[index].Latest < *limit)
+            *limit = _heap[index].Latest;
+        CollectLatest(index * 2 + 1, limit);
+        CollectLatest(index * 2 + 2, limit);
+    }
+
+    void Place(int index, const Entry& e) throw()
+    {
+        _heap[index] = e;
+        _slots[FindSlot(e.Id)].Index = index;
+    }
+
+    int SiftUp(int index, const Entry& e) throw()
+    {
+        while (index > 0) {
+            int parent = (index - 1) / 2;
+            if (!Less(e, _heap[parent]))
+                break;
+            Place(index, _heap[parent]);
+            index = parent;
+        }
+        Place(index, e);
+        return index;
+    }
+
+    int SiftDown(int index, const Entry& e) throw()
+    {
+        while (1) {
+            int child = index * 2 + 1;
+            if (child >= _count)
+                break;
+            if (child + 1 < _count && Less(_heap[child + 1], _heap[child]))
+                child++;
+            if (!Less(_heap[child], e))
+                break;
+            Place(index, _heap[child]);
+            index = child;
+        }
+        Place(index, e);
+        return index;
+    }
+
+    bool ReserveHeap(int count) throw()
+    {
+        if (count <= _capacity)
+            return true;
+        int capacity = _capacity == 0 ? 16 : _capacity * 2;
+        auto p = (Entry*)realloc(_heap, sizeof(Entry) * capacity);
+        if (p == nullptr)
+            return false;
+        _heap = p;
+        _capacity = capacity;
+        return true;
+    }
+
+    //哈希表的负载保持在 1/2 以下，扩容时重新插入所有的 ID
+    bool ReserveSlots(int count) throw()
+    {
+        int size = _slot_mask + 1;
+        if (count * 2 <= size)
+            return true;
+
+        int new_size = size == 0 ? 32 : size * 2;
+        while (count * 2 > new_size)
+            new_size *= 2;
+        auto slots = (Slot*)calloc(new_size, sizeof(Slot));
+        if (slots == nullptr)
+            return false;
+
+        auto old = _slots;
+        _slots = slots;
+        _slot_mask = new_size - 1;
+        for (int i = 0; i < _count; i++)
+            InsertSlot(_heap[i].Id, i);
+        if (old)
+            free(old);
+        return true;
+    }
+
+    int FindSlot(KF_TIMED_EVENT_ID id) const throw()
+    {
+        if (_slots == nullptr || id == TIMED_QUEUE_INVALID_EVENT_ID)
+            return -1;
+        for (unsigned i = HashId(id) & _slot_mask;; i = (i + 1) & _slot_mask) {
+            if (_slots[i].Id == id)
+                return (int)i;
+            if (_slots[i].Id == TIMED_QUEUE_INVALID_EVENT_ID)
+                return -1;
+        }
+    }
+
+    void InsertSlot(KF_TIMED_EVENT_ID id, int index) throw()
+    {
+        unsigned i = HashId(id) & _slot_mask;
+        while (_slots[i].Id != TIMED_QUEUE_INVALID_EVENT_ID)
+            i = (i + 1) & _slot_mask;
+        _slots[i].Id = id;
+        _slots[i].Index = index;
+    }
+
+    //线性探测的删除：把后面探测链上的元素往前移，保证查找不会提前遇到空位
+    void EraseSlot(int slot) throw()
+    {
+        unsigned hole = (unsigned)slot;
+        unsigned i = hole;
+        while (1) {
+            i = (i + 1) & _slot_mask;
+            if (_slots[i].Id == TIMED_QUEUE_INVALID_EVENT_ID)
+                break;
+            unsigned home = HashId(_slots[i].Id) & _slot_mask;
+            if (((i - home) & _slot_mask) >= ((i - hole) & _slot_mask)) {
+                _slots[hole] = _slots[i];
+                hole = i;
+            }
+        }
+        _slots[hole].Id = TIMED_QUEUE_INVALID_EVENT_ID;
+    }
+};
+
 class TimedEventQueue : public IKFTimedEventQueue_I, protected KFThreadObject
 {
     KF_IMPL_DECL_REFCOUNT;
 
     bool _bStarted, _bStopped; //状态指示符
-    KFPtr<IKFFastList> _queue; //任务队列
+    bool _bStopping; //已经提交了退出事件，周期事件不再重新排期
+
+    KF_INT64 _wakeTime; //队列线程正在等待到的时间（没有在等待时为 INT64_MIN）
+    KF_UINT64 _savedWakeups; //合并唤醒节省的次数
+    TimedEventHeap _queue; //任务队列（按期望执行时间排序的最小堆）
     KFMutex _mutex;
 
     void* _cvQueueNotEmpty; //通知任务队列不为空
@@ -27,7 +318,8 @@ public:
     TimedEventQueue() throw() :
     _ref_count(1), _mutex(true),
     _nextEventId(TIMED_QUEUE_STARTUP_EVENT_ID),
-    _bStarted(false), _bStopped(false) {}
+    _bStarted(false), _bStopped(false), _bStopping(false),
+    _wakeTime(INT64_MIN), _savedWakeups(0) {}
     virtual ~TimedEventQueue() throw()
     { Shutdown(SkipTasks, SyncShutdown); DestroyCondVars(); }
 
@@ -58,11 +350,7 @@ public:
             return KF_RE_ENTRY;
 
         _nextEventId = TIMED_QUEUE_STARTUP_EVENT_ID;
-        auto r = KFCreateObjectFastList(&_queue); //创建任务队列
-        if (KF_FAILED(r)) {
-            KFLOG_ERROR_T("%s -> Startup: KFCreateObjectFastList Failed.", "TimedEventQueue")
-            return r;
-        }
+        _queue.Clear();
 
         //创建条件变量
         if (!CreateCondVars()) {
@@ -70,14 +358,17 @@ public:
             return KF_INVALID_STATE;
         }
 
-        //启动任务队列线程
+        //启动任务队列线程（线程的引用在启动之前增加，OnThreadExit 释放）
+        Retain();
         if (!ThreadStart()) {
+            Recycle();
             KFLOG_ERROR_T("%s -> ThreadStart Failed.", "TimedEventQueue");
             return KF_ERROR;
         }
 
         _bStarted = true;
         _bStopped = false;
+        _bStopping = false;
         return KF_OK;
     }
 
@@ -102,10 +393,14 @@ public:
         
         //设置这个事件为请求队列线程中止
         state->SetEventType(IKFTimedEventState_I::EventStateType::QueueAbort);
+        {
+            KFMutex::AutoLock lock(_mutex);
+            _bStopping = true; //周期事件执行完当前这一次就结束，否则 ExecuteTasks 永远等不到队列尾
+        }
         if (flush_state == ExecuteTasks) //如果flush为Execute，插入到最后，等待前面的所有事件执行完成，此会方式卡死调用者
             r = PostEventToBack(s.Get(), nullptr);
         else
-            r = PostTimedEvent(s.Get(), INT64_MIN, nullptr, true) ? KF_OK : KF_ERROR; //插入到最前
+            r = PostTimedEvent(s.Get(), INT64_MIN, nullptr) ? KF_OK : KF_ERROR; //插入到最前
         
         KFLOG_T("%s -> PostEvent to Notify Exit. (Flush: %s)", "TimedEventQueue", (flush_state == ExecuteTasks ? "True" : "False"));
         if (KF_FAILED(r)) {
@@ -119,10 +414,7 @@ public:
             KFLOG_T("%s -> ThreadJoin Ended.", "TimedEventQueue");
 
             //清空任务队列
-            if (_queue) {
-                _queue->Clear();
-                _queue.Reset();
-            }
+            _queue.Clear();
             //销毁条件变量
             DestroyCondVars();
         }
@@ -133,11 +425,26 @@ public:
     }
 
     virtual KF_RESULT PostEvent(IKFTimedEventState* callback, KF_TIMED_EVENT_ID* id)
-    { return PostTimedEvent(callback, INT64_MIN + 1, id, false) ? KF_OK : KF_ERROR; }
+    { return PostTimedEvent(callback, INT64_MIN + 1, id) ? KF_OK : KF_ERROR; }
     virtual KF_RESULT PostEventToBack(IKFTimedEventState* callback, KF_TIMED_EVENT_ID* id)
-    { return PostTimedEvent(callback, INT64_MAX, id, false) ? KF_OK : KF_ERROR; }
+    { return PostTimedEvent(callback, INT64_MAX, id) ? KF_OK : KF_ERROR; }
     virtual KF_RESULT PostEventWithDelay(IKFTimedEventState* callback, KF_INT32 delay_ms, KF_TIMED_EVENT_ID* id)
-    { return PostTimedEvent(callback, KFGetTick() + (KF_INT64)delay_ms, id, true) ? KF_OK : KF_ERROR; }
+    { return PostTimedEvent(callback, KFGetTick() + (KF_INT64)delay_ms, id) ? KF_OK : KF_ERROR; }
+    virtual KF_RESULT PostPeriodicEvent(IKFTimedEventState* callback, KF_INT32 period_ms, PeriodicEventMode mode, KF_TIMED_EVENT_ID* id)
+    {
+        if (callback == nullptr || period_ms <= 0 || (mode != FixedRate && mode != FixedDelay))
+            return KF_INVALID_ARG;
+
+        //周期事件执行完 callback 才重新排期，没有 callback 的周期事件会一直留在堆顶
+        KFPtr<IKFTimedEventState_I> state;
+        KFPtr<IKFTimedEventCallback> cb;
+        if (KF_FAILED(KFBaseGetInterface(callback, _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE, &state)))
+            return KF_INVALID_ARG;
+        state->GetCallback(cb.ResetAndGetAddressOf());
+        if (cb == nullptr)
+            return KF_INVALID_ARG;
+        return PostTimedEvent(callback, KFGetTick() + (KF_INT64)period_ms, id, period_ms, mode) ? KF_OK : KF_ERROR;
+    }
 
     virtual KF_RESULT CancelEvent(KF_TIMED_EVENT_ID id)
     {
@@ -145,24 +452,17 @@ public:
             return KF_INVALID_ARG;
         
         KFMutex::AutoLock lock(_mutex);
-        KFLOG_INFO_T("%s -> CancelEvent %d (Queue-count: %d)", "TimedEventQueue", id, _queue->GetCount());
-        auto node = _queue->Begin();
-        while (node != _queue->End()) { //循环遍历所有的任务队列元素
-            KFPtr<IKFTimedEventState_I> state;
-            KFGetFastListObject<IKFTimedEventState_I>(_queue, node, _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE, &state);
-            
-            if (state->GetEventId() == id) { //如果找到这个任务项目
-                KFLOG_T("%s -> CancelEvent Found.", "TimedEventQueue");
-                if (node == _queue->Begin()) //如果要移除的项目是任务头
-                    KFCondVarSignal(_cvQueueHeadChanged); //通知条件变量，任务头改变，当前任务被移除，执行下一个任务
-                
-                state->SetEventId(TIMED_QUEUE_INVALID_EVENT_ID); //设置为无效的事件
-                _queue->Remove(node, nullptr); //从任务队列中移除
-                return KF_OK;
-            }
-            node = _queue->Next(node);
-        }
-        return KF_NOT_FOUND;
+        KFLOG_INFO_T("%s -> CancelEvent %d (Queue-count: %d)", "TimedEventQueue", id, _queue.GetCount());
+        KFPtr<IKFTimedEventState_I> state;
+        bool was_top = false;
+        if (!_queue.Remove(id, &state, &was_top)) //从任务队列中移除
+            return KF_NOT_FOUND;
+
+        KFLOG_T("%s -> CancelEvent Found.", "TimedEventQueue");
+        if (was_top) //如果移除的项目是任务头
+            KFCondVarSignal(_cvQueueHeadChanged); //通知条件变量，任务头改变，当前任务被移除，执行下一个任务
+        state->SetEventId(TIMED_QUEUE_INVALID_EVENT_ID); //设置为无效的事件
+        return KF_OK;
     }
     
     virtual KF_RESULT CancelAllEvents()
@@ -170,21 +470,25 @@ public:
         KFLOG_T("%s -> CancelAllEvents.", "TimedEventQueue");
         KFMutex::AutoLock lock(_mutex);
         KFCondVarSignal(_cvQueueHeadChanged); //通知正在等待就立即退出
-        _queue->Clear(); //移除所有的还未执行的事件
+        _queue.Clear(); //移除所有的还未执行的事件
         return KF_OK;
     }
 
     virtual int GetPendingEventCount()
     {
         KFMutex::AutoLock lock(_mutex);
-        return _queue->GetCount();
+        return _queue.GetCount();
+    }
+
+    virtual KF_UINT64 GetSavedWakeupCount()
+    {
+        KFMutex::AutoLock lock(_mutex);
+        return _savedWakeups;
     }
 
 public:
     virtual void* GetThread()
     { return ThreadObject(); }
-    virtual IKFFastList* GetQueue()
-    { return _queue; }
 
     virtual bool IsStartup()
     { return _bStarted; }
@@ -207,7 +511,8 @@ private:
         _cvQueueNotEmpty = _cvQueueHeadChanged = nullptr;
     }
 
-    bool PostTimedEvent(IKFTimedEventState* callback, KF_INT64 realtime, KF_TIMED_EVENT_ID* id, bool allow_prev)
+    bool PostTimedEvent(IKFTimedEventState* callback, KF_INT64 realtime, KF_TIMED_EVENT_ID* id,
+        KF_INT32 period_ms = 0, PeriodicEventMode period_mode = FixedRate)
     {
         if (!_bStarted)
             return false;
@@ -220,108 +525,106 @@ private:
             return false;
 
         KFLOG_T("%s -> PostTimedEvent (Realtime: %lld, Id: %d)...", "TimedEventQueue", realtime, _nextEventId);
-        if (id)
-            *id = _nextEventId; //本次任务的ID
-        state->SetEventId(_nextEventId++);
-        state->SetTime(realtime); //本次任务的期望执行时间（现实世界时间）
-
-        int index = 0;
-        bool time_is_equal = false;
-        auto node = _queue->Begin();
-        while (node != _queue->End()) {
-            KFPtr<IKFTimedEventState_I> task;
-            KFGetFastListObject<IKFTimedEventState_I>(_queue, node, _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE, &task);
-
-            KFLOG_T("%s -> PostTimedEvent %d ItemTime: %lld", "TimedEventQueue", index, state->GetTime());
-            if (task->GetTime() >= realtime) {
-                //找到一个比当前任务期望执行时间更大的任务
-                KFLOG_T("%s -> PostTimedEvent InsertIn: %d", "TimedEventQueue", index);
-                time_is_equal = (task->GetTime() == realtime);
-                break;
-            }
-            
-            node = _queue->Next(node);
-            index++;
+        //ID 回绕以后跳过无效 ID 和仍然在队列中的 ID
+        while (_nextEventId == TIMED_QUEUE_INVALID_EVENT_ID || _queue.Contains(_nextEventId))
+            _nextEventId++;
+
+        KF_TIMED_EVENT_ID eventId = _nextEventId;
+        state->SetEventId(eventId);
+        state->SetTime(realtime); //本次任务的期望执行时间（KFGetTick 的单调时钟）
+        state->SetPeriod(period_ms, period_mode);
+
+        //最晚执行时间，PostEvent/PostEventToBack/退出事件这些特殊的时间不使用 slack
+        KF_INT64 latest = realtime;
+        if (realtime >= 0 && realtime != INT64_MAX) {
+            KF_INT32 slack = state->GetSlack();
+            latest = realtime > INT64_MAX - slack ? INT64_MAX : realtime + slack;
         }
-        
-        auto saved_node = node;
-        if (node != nullptr && allow_prev && !time_is_equal) {
-            node = _queue->Prev(node); //取这个任务的上一个任务，保证按照时间从近到远的线性执行顺序
-            KFLOG_T("%s -> PostTimedEvent: Do Prev.", "TimedEventQueue");
+
+        //按照期望时间插入到堆中，时间相同的按照提交顺序执行
+        bool is_top = false;
+        if (!_queue.Push(state.Get(), eventId, realtime, latest, &is_top)) {
+            state->SetEventId(TIMED_QUEUE_INVALID_EVENT_ID);
+            KFLOG_ERROR_T("%s -> PostTimedEvent: Out of Memory.", "TimedEventQueue");
+            return false;
         }
-        if (saved_node == _queue->Begin()) { //如果被改变的任务在任务队列头
+        _nextEventId++;
+        if (id)
+            *id = eventId; //本次任务的ID
+
+        if (is_top || latest < _wakeTime) { //如果新的任务成为了任务队列头，或者要求比当前等待的时间更早执行
             KFLOG_T("%s -> PostTimedEvent: Wake QueueHeadChanged.", "TimedEventQueue");
             KFCondVarSignal(_cvQueueHeadChanged); //通知任务队列头改变，如果正在等待更久远的任务，立即退出，执行新的最优先的任务
         }
         
-        if (saved_node == _queue->Begin())
-            _queue->PushFront(callback); //插入到任务队列头
-        else
-            _queue->InsertBack(node, callback); //插入到任务队列任意合适的位置
-        
-        KFLOG_T("%s -> PostTimedEvent: Wake QueueNotEmpty. (QueueSize: %d)", "TimedEventQueue", _queue->GetCount());
+        KFLOG_T("%s -> PostTimedEvent: Wake QueueNotEmpty. (QueueSize: %d)", "TimedEventQueue", _queue.GetCount());
         KFCondVarSignal(_cvQueueNotEmpty); //通知任务队列有项目了，该去执行了
         return true;
     }
 
-    bool CheckAndRemoveEventById(KF_TIMED_EVENT_ID id) //根据ID检查项目是不是在任务队列中
+    //周期事件执行完成以后，在堆中原地调整到下一次的期望时间
+    void ReschedulePeriodicEvent(KF_TIMED_EVENT_ID id, IKFTimedEventState_I* state, KF_INT32 period, PeriodicEventMode mode)
     {
-        auto node = _queue->Begin();
-        while (node != _queue->End()) {
-            KFPtr<IKFTimedEventState_I> state;
-            KFGetFastListObject<IKFTimedEventState_I>(_queue, node, _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE, &state);
-
-            if (state->GetEventId() == id) {
-                _queue->Remove(node, nullptr);
-                return true;
-            }
+        KFMutex::AutoLock lock(_mutex);
+        if (_queue.Find(id) != state) //执行期间被取消了
+            return;
+        if (_bStopping) { //正在退出，这是最后一次执行
+            _queue.Remove(id, nullptr, nullptr);
+            return;
+        }
 
-            node = _queue->Next(node);
+        KF_INT64 now = KFGetTick();
+        KF_INT64 next;
+        if (mode == FixedRate) {
+            next = state->GetTime() + period; //以上一次的期望时间为基准，callback 的执行时间不会累积成漂移
+            if (next < now)
+                next += ((now - next) / period + 1) * period; //错过了期望时间，跳过丢失的周期，不连续补执行
+        }else{
+            next = now + period;
         }
-        return false;
+
+        KFLOG_T("%s -> Reschedule Periodic Event %d: %lld", "TimedEventQueue", id, next);
+        state->SetTime(next);
+        _queue.Update(id, next);
     }
 
 protected:
     virtual void OnThreadInvoke(void*)
     {
         KFLOG_T("%s -> OnThreadInvoke Begin...", "TimedEventQueue");
-        Retain();
+        KF_INT64 batchEnd = INT64_MIN; //最近一次唤醒合并到的时间，期望时间不超过它的事件都在这次唤醒中执行
+        KF_INT64 batchLast = INT64_MIN; //这次唤醒中上一个执行的事件的期望时间
         while (1)
         {
             KFPtr<IKFTimedEventCallback> callback;
             KFPtr<IKFTimedEventState_I> state;
+            KF_TIMED_EVENT_ID eventId = TIMED_QUEUE_INVALID_EVENT_ID;
+            KF_INT32 period = 0;
+            PeriodicEventMode periodMode = FixedRate;
             {
                 KFMutex::AutoLock lock(_mutex);
                 if (_bStopped) {
                     //异步销毁条件变量
                     DestroyCondVars();
                     //异步销毁任务队列
-                    _queue->Clear();
-                    _queue.Reset();
+                    _queue.Clear();
                     break;
                 }
                 
-                while (_queue->IsEmpty()) {
+                while (_queue.IsEmpty()) {
                     KFLOG_T("%s -> Enter: QueueNotEmpty...", "ThreadInvoke");
                     KFCondVarWait(_cvQueueNotEmpty, _mutex.Get()); //等待任务队列不为空事件
                 }
                 KFLOG_T("%s -> Leave: QueueNotEmpty.", "ThreadInvoke");
                 
-                KF_TIMED_EVENT_ID eventId = TIMED_QUEUE_INVALID_EVENT_ID;
                 while (1) {
-                    if (_queue->IsEmpty()) {
+                    if (_queue.IsEmpty()) {
                         //在KFCondVarWaitTimed等待期间，任务队列可能已经被清空
                         KFLOG_WARN_T("%s -> Loop Break: Queue is Empty.", "ThreadInvoke");
                         break;
                     }
                     
-                    KFPtr<IKFBaseObject> event;
-                    if (!_queue->GetFront(&event)) {
-                        KFLOG_WARN_T("%s -> GetFront is None.", "ThreadInvoke");
-                        break;
-                    }
-                    
-                    KFBaseGetInterface(event.Get(), _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE, &state);
+                    state = _queue.GetTop();
                     if (state == nullptr) {
                         KFLOG_WARN_T("%s -> Invalid Event Object.", "ThreadInvoke");
                         break;
@@ -332,6 +635,10 @@ protected:
                     
                     KF_INT64 currentTime = KFGetTick(); //当前的时间
                     KF_INT64 requestTime = state->GetTime(); //期望要执行的时间（语义上是“未来的时间”）
+                    //不属于上一次唤醒的批次并且还没有到期时，有 slack 的话合并到窗口重叠的最晚时间
+                    //已经到期的事件立即执行，不需要计算（否则连续到期的一批事件每个都要重新计算一次）
+                    if (requestTime > batchEnd && requestTime > currentTime)
+                        requestTime = _queue.GetCoalescedDeadline();
                     
                     int sleepTime;
                     if (requestTime < 0 || requestTime == INT64_MAX) //特殊处理，比如 QueueAbort 的情况
@@ -354,14 +661,39 @@ protected:
                     //等待当前的任务到达指定的时间，这里会解锁互斥锁，所以外部可以Post新的任务进来
                     //如果新的任务的执行时间比现在要等待到的期望时间更早，则QueueHeadChanged会被通知
                     //函数退出等待，然后执行时间更早的更优先的任务，当前等待的任务被延后执行。
+                    _wakeTime = requestTime;
                     auto r = KFCondVarWaitTimed(_cvQueueHeadChanged, _mutex.Get(), sleepTime);
+                    _wakeTime = INT64_MIN;
                     KFLOG_T("%s -> TimedWait Leave. %lld", "ThreadInvoke", KFGetTick());
-                    if (!timeoutCapped && r == KF_EVENT_TIME_OUT) //判断是不是10超时分批等待（timeoutCapped）
+                    if (!timeoutCapped && r == KF_EVENT_TIME_OUT) { //判断是不是10超时分批等待（timeoutCapped）
+                        batchEnd = requestTime;
+                        batchLast = INT64_MIN;
                         break; //如果不是，那时间到了，去执行任务
+                    }
                 }
                 
-                if (eventId != TIMED_QUEUE_INVALID_EVENT_ID && CheckAndRemoveEventById(eventId))
-                    state->GetCallback(callback.ResetAndGetAddressOf()); //从队列中移除任务并取得callback
+                if (eventId != TIMED_QUEUE_INVALID_EVENT_ID) {
+                    period = state->GetPeriod(&periodMode);
+                    if (period > 0) {
+                        if (_queue.Find(eventId) == state.Get()) { //周期事件留在队列中，执行完成以后重新排期
+                            state->GetCallback(callback.ResetAndGetAddressOf());
+                            if (callback == nullptr) //callback 已经被清除，不会再重新排期，移除（否则一直在堆顶空转）
+                                _queue.Remove(eventId, nullptr, nullptr);
+                        }
+                    }else if (_queue.Remove(eventId, nullptr, nullptr)) {
+                        state->GetCallback(callback.ResetAndGetAddressOf()); //从队列中移除任务并取得callback
+                    }
+                }
+
+                if (callback != nullptr) {
+                    //同一次唤醒中执行了多个不同期望时间的事件，没有 slack 时它们每个都需要单独唤醒一次
+                    KF_INT64 eventTime = state->GetTime();
+                    if (eventTime >= 0 && eventTime != INT64_MAX && eventTime <= batchEnd) {
+                        if (batchLast != INT64_MIN && eventTime != batchLast)
+                            _savedWakeups++;
+                        batchLast = eventTime;
+                    }
+                }
             }
             
             if (callback != nullptr) {
@@ -369,6 +701,8 @@ protected:
                     KFLOG_T("%s -> Execute Event: %d", "ThreadInvoke", state->GetEventId());
                     callback->Invoke(state.Get(), this); //执行callback
                 }
+                if (period > 0)
+                    ReschedulePeriodicEvent(eventId, state.Get(), period, periodMode);
             }else if (state != nullptr) {
                 if (state->GetEventType() == IKFTimedEventState_I::EventStateType::QueueAbort) {
                     _bStopped = true; //如果是通过Shutdown调用发出来的QueueAbort任务，就退出整个线程的循环
@@ -7,9 +7,9 @@
 typedef KF_UINT32 KF_TIMED_EVENT_ID;
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_TIMED_EVENT_STATE "kf_iid_timed_event_state"
+#define _KF_INTERFACE_ID_TIMED_EVENT_STATE _KF_IID("kf_iid_timed_event_state")
 #else
-#define _KF_INTERFACE_ID_TIMED_EVENT_STATE "E4BE8685EE164F31B57F2D9AB27A24F1"
+#define _KF_INTERFACE_ID_TIMED_EVENT_STATE _KF_IID("E4BE8685EE164F31B57F2D9AB27A24F1")
 #endif
 struct IKFTimedEventState : public IKFBaseObject
 {
@@ -19,12 +19,17 @@ struct IKFTimedEventState : public IKFBaseObject
     virtual void SetObject(IKFBaseObject* object) = 0;
     virtual KF_RESULT GetObject(IKFBaseObject** object) = 0;
     virtual IKFBaseObject* GetObjectNoRef() = 0;
+
+    //允许延后执行的时间（毫秒），事件在 [期望时间, 期望时间 + slack] 内的任意时刻执行都可以
+    //队列会把时间窗口重叠的事件合并到一次唤醒中执行，默认为 0
+    virtual void SetSlack(KF_INT32 slack_ms) = 0;
+    virtual KF_INT32 GetSlack() = 0;
 };
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_TIMED_EVENT_CALLBACK "kf_iid_timed_event_callback"
+#define _KF_INTERFACE_ID_TIMED_EVENT_CALLBACK _KF_IID("kf_iid_timed_event_callback")
 #else
-#define _KF_INTERFACE_ID_TIMED_EVENT_CALLBACK "7F132407B6664A5AA4667B982381A0D5"
+#define _KF_INTERFACE_ID_TIMED_EVENT_CALLBACK _KF_IID("7F132407B6664A5AA4667B982381A0D5")
 #endif
 struct IKFTimedEventCallback : public IKFBaseObject
 {
@@ -32,9 +37,9 @@ struct IKFTimedEventCallback : public IKFBaseObject
 };
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_TIMED_EVENT_QUEUE "kf_iid_timed_event_queue"
+#define _KF_INTERFACE_ID_TIMED_EVENT_QUEUE _KF_IID("kf_iid_timed_event_queue")
 #else
-#define _KF_INTERFACE_ID_TIMED_EVENT_QUEUE "035A1FBC9C364681B422A4E461DFE198"
+#define _KF_INTERFACE_ID_TIMED_EVENT_QUEUE _KF_IID("035A1FBC9C364681B422A4E461DFE198")
 #endif
 struct IKFTimedEventQueue : public IKFBaseObject
 {
@@ -48,6 +53,11 @@ struct IKFTimedEventQueue : public IKFBaseObject
         SyncShutdown = 0,
         AsyncShutdown = 1
     };
+    enum PeriodicEventMode
+    {
+        FixedRate = 0, //按照固定的时间点执行（第一次的期望时间 + N 个周期），错过的周期直接跳过
+        FixedDelay = 1 //上一次执行完成以后再等待一个周期
+    };
 
     virtual KF_RESULT Startup() = 0;
     virtual KF_RESULT Shutdown(QueueShutdownFlushState flush_state, QueueShutdownAsyncMode async_mode) = 0;
@@ -55,11 +65,14 @@ struct IKFTimedEventQueue : public IKFBaseObject
     virtual KF_RESULT PostEvent(IKFTimedEventState* callback, KF_TIMED_EVENT_ID* id) = 0;
     virtual KF_RESULT PostEventToBack(IKFTimedEventState* callback, KF_TIMED_EVENT_ID* id) = 0;
     virtual KF_RESULT PostEventWithDelay(IKFTimedEventState* callback, KF_INT32 delay_ms, KF_TIMED_EVENT_ID* id) = 0;
+    //周期事件：第一次在 period_ms 以后执行，之后一直重复，直到 CancelEvent/CancelAllEvents 或者 Shutdown（ID 保持不变）
+    virtual KF_RESULT PostPeriodicEvent(IKFTimedEventState* callback, KF_INT32 period_ms, PeriodicEventMode mode, KF_TIMED_EVENT_ID* id) = 0;
 
     virtual KF_RESULT CancelEvent(KF_TIMED_EVENT_ID id) = 0;
     virtual KF_RESULT CancelAllEvents() = 0;
 
     virtual int GetPendingEventCount() = 0;
+    virtual KF_UINT64 GetSavedWakeupCount() = 0; //因为 slack 合并而节省的唤醒次数
 };
 
 // ***************
@@ -9,9 +9,9 @@
 #define TIMED_QUEUE_STARTUP_EVENT_ID 1
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE "__kf_iid_timed_event_state"
+#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE _KF_IID("__kf_iid_timed_event_state")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE "_E4B1CEC02FB3492F9C76873509CBA757"
+#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_STATE _KF_IID("_E4B1CEC02FB3492F9C76873509CBA757")
 #endif
 struct IKFTimedEventState_I : public IKFTimedEventState
 {
@@ -21,6 +21,10 @@ struct IKFTimedEventState_I : public IKFTimedEventState
     virtual void SetEventId(KF_TIMED_EVENT_ID id) = 0;
     virtual KF_TIMED_EVENT_ID GetEventId() = 0;
 
+    //period_ms 为 0 表示一次性的事件
+    virtual void SetPeriod(KF_INT32 period_ms, IKFTimedEventQueue::PeriodicEventMode mode) = 0;
+    virtual KF_INT32 GetPeriod(IKFTimedEventQueue::PeriodicEventMode* mode) = 0;
+
     virtual void SetCallback(IKFTimedEventCallback* callback) = 0;
     virtual void GetCallback(IKFTimedEventCallback** callback) = 0;
 
@@ -34,14 +38,13 @@ struct IKFTimedEventState_I : public IKFTimedEventState
 };
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_QUEUE "__kf_iid_timed_event_queue"
+#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_QUEUE _KF_IID("__kf_iid_timed_event_queue")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_QUEUE "_69CE7438B7A64E52AF17BD4020564C13"
+#define _INTERNAL_KF_INTERFACE_ID_TIMED_EVENT_QUEUE _KF_IID("_69CE7438B7A64E52AF17BD4020564C13")
 #endif
 struct IKFTimedEventQueue_I : public IKFTimedEventQueue
 {
     virtual void* GetThread() = 0;
-    virtual IKFFastList* GetQueue() = 0;
     
     virtual bool IsStartup() = 0;
     virtual bool IsStopped() = 0;
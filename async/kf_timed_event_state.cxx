@@ -11,9 +11,15 @@ class TimedEventState : public IKFTimedEventState_I
         IKFBaseObject* object;
         KF_TIMED_EVENT_ID id;
         KF_INT64 time;
+        KF_INT32 period;
+        IKFTimedEventQueue::PeriodicEventMode periodMode;
+        KF_INT32 slack;
 
         State() throw()
-        { id = TIMED_QUEUE_INVALID_EVENT_ID; time = 0; callback = nullptr; object = nullptr; }
+        {
+            id = TIMED_QUEUE_INVALID_EVENT_ID; time = 0; callback = nullptr; object = nullptr;
+            period = 0; periodMode = IKFTimedEventQueue::FixedRate; slack = 0;
+        }
         ~State() throw()
         { if (object) object->Recycle(); if (callback) callback->Recycle(); }
     };
@@ -109,6 +115,17 @@ public:
         return _state.object;
     }
 
+    virtual void SetSlack(KF_INT32 slack_ms)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        _state.slack = slack_ms > 0 ? slack_ms : 0;
+    }
+    virtual KF_INT32 GetSlack()
+    {
+        KFMutex::AutoLock lock(_mutex);
+        return _state.slack;
+    }
+
 public:
     virtual void SetTime(KF_INT64 time)
     {
@@ -132,6 +149,20 @@ public:
         return _state.id;
     }
 
+    virtual void SetPeriod(KF_INT32 period_ms, IKFTimedEventQueue::PeriodicEventMode mode)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        _state.period = period_ms;
+        _state.periodMode = mode;
+    }
+    virtual KF_INT32 GetPeriod(IKFTimedEventQueue::PeriodicEventMode* mode)
+    {
+        KFMutex::AutoLock lock(_mutex);
+        if (mode)
+            *mode = _state.periodMode;
+        return _state.period;
+    }
+
     virtual void SetCallback(IKFTimedEventCallback* callback)
     {
         KFMutex::AutoLock lock(_mutex);
@@ -4,9 +4,9 @@
 #include <base/kf_base.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_OBJECT_ARRAY_LIST "kf_iid_object_array_list"
+#define _KF_INTERFACE_ID_OBJECT_ARRAY_LIST _KF_IID("kf_iid_object_array_list")
 #else
-#define _KF_INTERFACE_ID_OBJECT_ARRAY_LIST "D30F93364CCB4CBFBD8DC8F7A86E3544"
+#define _KF_INTERFACE_ID_OBJECT_ARRAY_LIST _KF_IID("D30F93364CCB4CBFBD8DC8F7A86E3544")
 #endif
 struct IKFArrayList : public IKFBaseObject
 {
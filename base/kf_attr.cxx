@@ -53,7 +53,7 @@ private:
         int _state;
         char* _reference;
 
-        KREF _ref_count;
+        KF_IMPL_DECL_REFCOUNT;
 
     public:
         Store() throw() : _ref_count(1), _state(-1), _reference(nullptr)
@@ -946,10 +946,15 @@ public:
         if (_observers == nullptr)
             return KF_NOT_SUPPORTED;
 
+        //已经有 Worker 的时候两种异步模式共用，通知的顺序不变
         if (mode == KF_ATTR_OBSERVER_THREAD_ASYNC_POOL && _observer_worker == nullptr) {
             auto r = KFAsyncCreateWorker(false, 1, &_observer_worker);
             _KF_FAILED_RET(r);
         }
+        if (mode == KF_ATTR_OBSERVER_THREAD_ASYNC_STRAND && _observer_worker == nullptr) {
+            auto r = KFAsyncCreateStrand(nullptr, &_observer_worker);
+            _KF_FAILED_RET(r);
+        }
 
         _observer_mode = mode;
         return KF_OK;
@@ -1100,7 +1105,8 @@ private:
 
         if (_observer_mode == KF_ATTR_OBSERVER_THREAD_DIRECT_CALL)
             InvokeAllObserver(key, change_or_delete);
-        else if (_observer_mode == KF_ATTR_OBSERVER_THREAD_ASYNC_POOL)
+        else if (_observer_mode == KF_ATTR_OBSERVER_THREAD_ASYNC_POOL ||
+                 _observer_mode == KF_ATTR_OBSERVER_THREAD_ASYNC_STRAND)
             NotifyObserverAsync(key, change_or_delete);
     }
 
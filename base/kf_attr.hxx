@@ -5,11 +5,11 @@
 #include <base/kf_buffer.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_ATTRIBUTES "kf_iid_attributes"
-#define _KF_INTERFACE_ID_ATTRIBUTES_OBSERVER "kf_iid_attributes_observer"
+#define _KF_INTERFACE_ID_ATTRIBUTES _KF_IID("kf_iid_attributes")
+#define _KF_INTERFACE_ID_ATTRIBUTES_OBSERVER _KF_IID("kf_iid_attributes_observer")
 #else
-#define _KF_INTERFACE_ID_ATTRIBUTES "1870E66918D3410B9003AF11C50EC7B1"
-#define _KF_INTERFACE_ID_ATTRIBUTES_OBSERVER "7712CB769EA04D7F8D6B9718728FE1B5"
+#define _KF_INTERFACE_ID_ATTRIBUTES _KF_IID("1870E66918D3410B9003AF11C50EC7B1")
+#define _KF_INTERFACE_ID_ATTRIBUTES_OBSERVER _KF_IID("7712CB769EA04D7F8D6B9718728FE1B5")
 #endif
 
 enum KF_ATTRIBUTE_TYPE
@@ -26,7 +26,8 @@ enum KF_ATTRIBUTE_TYPE
 enum KF_ATTRIBUTE_OBSERVER_THREAD_MODE
 {
     KF_ATTR_OBSERVER_THREAD_DIRECT_CALL = 0, //同步调用
-    KF_ATTR_OBSERVER_THREAD_ASYNC_POOL       //异步调用
+    KF_ATTR_OBSERVER_THREAD_ASYNC_POOL,      //异步调用
+    KF_ATTR_OBSERVER_THREAD_ASYNC_STRAND     //异步调用（在全局并行 Worker 的 Strand 上按顺序执行，不创建线程）
 };
 
 struct IKFAttributesObserver : public IKFBaseObject
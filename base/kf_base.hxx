@@ -7,6 +7,8 @@
 #include <cstdint>
 #include <cstddef>
 #include <cstdarg>
+#include <atomic>
+#include <type_traits>
 
 #include <math.h>
 #include <string.h>
@@ -31,7 +33,25 @@
 #define _KFRefDec(x) __sync_sub_and_fetch((x),1)
 #endif
 
-typedef const char* KIID;
+//接口 ID 的哈希（FNV-1a），常量字符串在编译期计算
+constexpr KF_UINT32 _KFInterfaceIdHash(const char* id, KF_UINT32 hash = 2166136261u)
+{ return *id ? _KFInterfaceIdHash(id + 1, (hash ^ static_cast<KF_UINT8>(*id)) * 16777619u) : hash; }
+
+//接口 ID：字符串以及它的哈希值，也可以当作 const char* 使用
+//_KF_INTERFACE_ID_* 宏都是 _KF_IID 构造的常量；从普通字符串隐式构造时在运行时计算哈希
+struct KIID
+{
+    const char* Id;
+    KF_UINT32 Hash;
+
+    constexpr KIID() throw() : Id(nullptr), Hash(0) {}
+    constexpr KIID(decltype(nullptr)) throw() : Id(nullptr), Hash(0) {}
+    constexpr KIID(const char* id) throw() : Id(id), Hash(id ? _KFInterfaceIdHash(id) : 0) {}
+    constexpr KIID(const char* id, KF_UINT32 hash) throw() : Id(id), Hash(hash) {}
+    constexpr operator const char*() const throw() { return Id; }
+};
+//用字符串常量定义接口 ID，哈希作为模板参数强制在编译期计算
+#define _KF_IID(id) KIID((id), std::integral_constant<KF_UINT32, _KFInterfaceIdHash(id)>::value)
 #ifdef _MSC_VER
 typedef long KREF;
 #else
@@ -52,19 +72,27 @@ typedef int KREF;
 #define KF_ARRAY_COUNT(ary) (sizeof(ary) / sizeof(ary[0]))
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_BASE_OBJECT       "kf_iid_bo"
-#define _KF_INTERFACE_ID_DUMMY_OBJECT      "kf_iid_dummy_object"
-#define _KF_INTERFACE_ID_OBJECT_FACTORY    "kf_iid_object_factory"
-#define _KF_INTERFACE_ID_OBJECT_READWRITE  "kf_iid_object_readwrite"
+#define _KF_INTERFACE_ID_BASE_OBJECT       _KF_IID("kf_iid_bo")
+#define _KF_INTERFACE_ID_DUMMY_OBJECT      _KF_IID("kf_iid_dummy_object")
+#define _KF_INTERFACE_ID_OBJECT_FACTORY    _KF_IID("kf_iid_object_factory")
+#define _KF_INTERFACE_ID_OBJECT_READWRITE  _KF_IID("kf_iid_object_readwrite")
 #else
-#define _KF_INTERFACE_ID_BASE_OBJECT       "0000000000000000C000000000000046"
-#define _KF_INTERFACE_ID_DUMMY_OBJECT      "0000000100000000C000000000000046"
-#define _KF_INTERFACE_ID_OBJECT_FACTORY    "0000000200000000C000000000000046"
-#define _KF_INTERFACE_ID_OBJECT_READWRITE  "0000000300000000C000000000000046"
+#define _KF_INTERFACE_ID_BASE_OBJECT       _KF_IID("0000000000000000C000000000000046")
+#define _KF_INTERFACE_ID_DUMMY_OBJECT      _KF_IID("0000000100000000C000000000000046")
+#define _KF_INTERFACE_ID_OBJECT_FACTORY    _KF_IID("0000000200000000C000000000000046")
+#define _KF_INTERFACE_ID_OBJECT_READWRITE  _KF_IID("0000000300000000C000000000000046")
 #endif
 #define _KF_INTERFACE_ID_UNKNOWN _KF_INTERFACE_ID_BASE_OBJECT
 
-#define _KFInterfaceIdEqual(id0, id1) (!strcmp(id0, id1))
+//同一个模块里相同的字符串常量一般是同一个指针，先比较指针，再比较（已经算好的）哈希，哈希相同才 strcmp（其他模块的 ID）
+inline bool _KFInterfaceIdEqual(const KIID& id0, const KIID& id1) throw()
+{
+    if (id0.Id == id1.Id)
+        return true;
+    if (id0.Hash != id1.Hash || id0.Id == nullptr || id1.Id == nullptr)
+        return false;
+    return !strcmp(id0.Id, id1.Id);
+}
 
 struct IKFBaseObject
 {
@@ -123,21 +151,54 @@ inline bool KFBaseHasInterface(void* object, KIID interface_id)
 
 // *** Implement Helper *** //
 
+//引用计数：增加不需要同步（调用者已经持有一个引用），减少用 release，减到 0 时再 acquire，保证 delete 之前看到其他线程的所有写入
+inline KREF _KFRefRetain(std::atomic<KREF>* xref) throw()
+{ return xref->fetch_add(1, std::memory_order_relaxed) + 1; }
+inline KREF _KFRefRelease(std::atomic<KREF>* xref) throw()
+{
+    KREF rc = xref->fetch_sub(1, std::memory_order_release) - 1;
+    if (rc == 0)
+        std::atomic_thread_fence(std::memory_order_acquire);
+    return rc;
+}
+//兼容自己声明 volatile KREF 的对象（全屏障）
+inline KREF _KFRefRetain(volatile KREF* xref) throw()
+{ return _KFRefInc(xref); }
+inline KREF _KFRefRelease(volatile KREF* xref) throw()
+{ return _KFRefDec(xref); }
+
 #define KF_IMPL_DECL_REFCOUNT \
-    volatile KREF _ref_count
+    std::atomic<KREF> _ref_count
+//只在一个线程里使用的对象（不需要原子操作），配合 KF_IMPL_*_ST 使用
+#define KF_IMPL_DECL_REFCOUNT_ST \
+    KREF _ref_count
 
 #define KF_IMPL_RETAIN(xref)    \
     KREF Retain()                \
-    { return _KFRefInc(&xref); }
+    { return _KFRefRetain(&xref); }
 #define KF_IMPL_RECYCLE(xref)   \
     KREF Recycle()               \
-    { KREF rc = _KFRefDec(&xref); \
+    { KREF rc = _KFRefRelease(&xref); \
     if (rc == 0) delete this; return rc; }
 
 #define KF_IMPL_RETAIN_FUNC(xref) \
-    return _KFRefInc(&xref)
+    return _KFRefRetain(&xref)
 #define KF_IMPL_RECYCLE_FUNC(xref) \
-    KREF rc = _KFRefDec(&xref);    \
+    KREF rc = _KFRefRelease(&xref); \
+    if (rc == 0) delete this; return rc
+
+#define KF_IMPL_RETAIN_ST(xref) \
+    KREF Retain()                \
+    { return ++xref; }
+#define KF_IMPL_RECYCLE_ST(xref) \
+    KREF Recycle()               \
+    { KREF rc = --xref;          \
+    if (rc == 0) delete this; return rc; }
+
+#define KF_IMPL_RETAIN_FUNC_ST(xref) \
+    return ++xref
+#define KF_IMPL_RECYCLE_FUNC_ST(xref) \
+    KREF rc = --xref;                 \
     if (rc == 0) delete this; return rc
 
 #define KF_IMPL_CHECK_PARAM \
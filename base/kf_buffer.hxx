@@ -4,9 +4,9 @@
 #include <base/kf_base.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_BUFFER "kf_iid_buffer"
+#define _KF_INTERFACE_ID_BUFFER _KF_IID("kf_iid_buffer")
 #else
-#define _KF_INTERFACE_ID_BUFFER "DEF410B560524DAE8645FAE8150CA602"
+#define _KF_INTERFACE_ID_BUFFER _KF_IID("DEF410B560524DAE8645FAE8150CA602")
 #endif
 struct IKFBuffer : public IKFBaseObject
 {
@@ -4,9 +4,9 @@
 #include <base/kf_buffer.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _INTERNAL_KF_INTERFACE_ID_BUFFER "__kf_iid_buffer"
+#define _INTERNAL_KF_INTERFACE_ID_BUFFER _KF_IID("__kf_iid_buffer")
 #else
-#define _INTERNAL_KF_INTERFACE_ID_BUFFER "1D512C7CDA4C4CE3B3F6F75167182478"
+#define _INTERNAL_KF_INTERFACE_ID_BUFFER _KF_IID("1D512C7CDA4C4CE3B3F6F75167182478")
 #endif
 struct IKFBuffer_I : public IKFBuffer
 {
@@ -6,9 +6,9 @@
 typedef void (KFAPI* KFDelegateObjectCallback)(void*);
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_DELEGATE_OBJECT "kf_iid_delegate_object"
+#define _KF_INTERFACE_ID_DELEGATE_OBJECT _KF_IID("kf_iid_delegate_object")
 #else
-#define _KF_INTERFACE_ID_DELEGATE_OBJECT "6C66056983134D3DAB537D8266070339"
+#define _KF_INTERFACE_ID_DELEGATE_OBJECT _KF_IID("6C66056983134D3DAB537D8266070339")
 #endif
 #define _KF_INTERFACE_ID_BOUNDARY_OBJECT _KF_INTERFACE_ID_DELEGATE_OBJECT
 struct IKFDelegateObject : public IKFBaseObject
@@ -4,9 +4,9 @@
 #include <base/kf_base.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_OBJECT_FAST_LIST "kf_iid_object_fast_list"
+#define _KF_INTERFACE_ID_OBJECT_FAST_LIST _KF_IID("kf_iid_object_fast_list")
 #else
-#define _KF_INTERFACE_ID_OBJECT_FAST_LIST "8C3B4EB91B474C06A0828515A0C1A8A0"
+#define _KF_INTERFACE_ID_OBJECT_FAST_LIST _KF_IID("8C3B4EB91B474C06A0828515A0C1A8A0")
 #endif
 struct IKFFastList : public IKFBaseObject
 {
@@ -24,13 +24,7 @@ public:
     KFPtr() throw() : _ptr(nullptr) {}
     KFPtr(Type* ptr) throw() : _ptr(ptr) { InternalAddRef(); }
     KFPtr(const KFPtr<Type>& other) throw() : _ptr(other._ptr) { InternalAddRef(); }
-    KFPtr(KFPtr<Type>&& other) throw() //Move with C++11.
-    {
-        if (this != reinterpret_cast<KFPtr*>(&reinterpret_cast<unsigned char&>(other))) {
-            _ptr = other._ptr;
-            other._ptr = nullptr;
-        }
-    }
+    KFPtr(KFPtr<Type>&& other) throw() : _ptr(other._ptr) { other._ptr = nullptr; } //Move with C++11.
     ~KFPtr() throw() { InternalRelease(); }
 
     KFPtr& operator=(Type* ptr) throw()
@@ -46,7 +40,24 @@ public:
     }
     KFPtr& operator=(const KFPtr<Type>& other) throw()
     { return operator=(other._ptr); }
-    KFPtr& operator=(KFPtr<Type>&& other) = delete;
+    KFPtr& operator=(KFPtr<Type>&& other) throw() //转移所有权，不增减引用计数
+    {
+        if (this != reinterpret_cast<KFPtr*>(&reinterpret_cast<unsigned char&>(other))) { //operator& 被重载了
+            Type* old = _ptr;
+            _ptr = other._ptr;
+            other._ptr = nullptr;
+            if (old)
+                old->Recycle();
+        }
+        return *this;
+    }
+
+    void Swap(KFPtr<Type>& other) throw()
+    {
+        Type* tmp = _ptr;
+        _ptr = other._ptr;
+        other._ptr = tmp;
+    }
 
     void Attach(Type* ptr) throw()
     {
@@ -4,9 +4,9 @@
 #include <base/kf_base.hxx>
 
 #ifndef KF_INTERFACE_ID_USE_GUID
-#define _KF_INTERFACE_ID_OBJECT_QUEUE "kf_iid_object_queue"
+#define _KF_INTERFACE_ID_OBJECT_QUEUE _KF_IID("kf_iid_object_queue")
 #else
-#define _KF_INTERFACE_ID_OBJECT_QUEUE "CE79C3C2775A43BABCF0F4D4410D962B"
+#define _KF_INTERFACE_ID_OBJECT_QUEUE _KF_IID("CE79C3C2775A43BABCF0F4D4410D962B")
 #endif
 struct IKFQueue : public IKFBaseObject
 {
@@ -27,7 +27,7 @@
   CURLOPT_DNS_SERVERS
 */
 
-#define _KF_INTERFACE_ID_JP_CURL_DOWNLOADER "kf_iid_jp_curl_downloader"
+#define _KF_INTERFACE_ID_JP_CURL_DOWNLOADER _KF_IID("kf_iid_jp_curl_downloader")
 struct IKFJPCurlDownloader : public IKFBaseObject {
 	virtual KF_RESULT SetUrl(const char* url) = 0;
 	virtual KF_RESULT SetUserAgent(const char* userAgent) = 0;
@@ -2,12 +2,25 @@
 #include "kf_sys_platform.h"
 #include <stdlib.h>
 
+//计数和强制唤醒的结果都用原子操作，不需要锁；只有最后一个完成的任务（或者强制唤醒）才 Set 事件
+//Linux 下 KFEvent 基于 futex，没有线程在 Wait 时 Set 也不会进入内核
+#ifdef _MSC_VER
+#define KF_NOTIFY_ADD(ptr, v) (InterlockedExchangeAdd((volatile LONG*)(ptr), (v)) + (v))
+#define KF_NOTIFY_CAS(ptr, expected, value) (InterlockedCompareExchange((volatile LONG*)(ptr), (value), (expected)) == (expected))
+#define KF_NOTIFY_SWAP(ptr, value) InterlockedExchange((volatile LONG*)(ptr), (value))
+#define KF_NOTIFY_LOAD(ptr) InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0)
+#else
+#define KF_NOTIFY_ADD(ptr, v) __atomic_add_fetch((ptr), (v), __ATOMIC_SEQ_CST)
+#define KF_NOTIFY_CAS(ptr, expected, value) __sync_bool_compare_and_swap((ptr), (expected), (value))
+#define KF_NOTIFY_SWAP(ptr, value) __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define KF_NOTIFY_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#endif
+
 typedef struct {
-    void* mutex;
     void* event;
     int fixedCount;
-    int dynamicCount; //volatile
-    int forceWaked;
+    int dynamicCount; //原子操作
+    int forceWaked; //原子操作
 } KFCompletionNotify;
 
 void* KF_SYS_CALL KFCompletionNotifyCreate(int taskCount)
@@ -15,28 +28,18 @@ void* KF_SYS_CALL KFCompletionNotifyCreate(int taskCount)
     if (taskCount == 0)
         return NULL;
     
-    KFCompletionNotify notify = {0};
-    notify.fixedCount = taskCount; //任务总数
-    notify.dynamicCount = 0; //在运行中已完成的任务总数
-    notify.event = KFEventCreate(0, 0); //完成所有任务后通知的event
-    notify.mutex = KFMutexCreate(0); //保证多线程安全的lock
-    if (notify.event == NULL ||
-        notify.mutex == NULL) {
-        if (notify.event)
-            KFEventDestroy(notify.event);
-        if (notify.mutex)
-            KFMutexDestroy(notify.mutex);
-        return NULL;
-    }
-    
     KFCompletionNotify* result = malloc(sizeof(KFCompletionNotify));
-    if (result == NULL) {
-        KFEventDestroy(notify.event);
-        KFMutexDestroy(notify.mutex);
+    if (result == NULL)
+        return NULL;
+
+    result->fixedCount = taskCount; //任务总数
+    result->dynamicCount = 0; //在运行中已完成的任务总数
+    result->forceWaked = 0;
+    result->event = KFEventCreate(0, 0); //完成所有任务后通知的event
+    if (result->event == NULL) {
+        free(result);
         return NULL;
     }
-    
-    *result = notify;
     return result;
 }
 
@@ -47,7 +50,6 @@ void KF_SYS_CALL KFCompletionNotifyDestroy(void* notify)
     
     KFCompletionNotify* core = (KFCompletionNotify*)notify;
     KFEventDestroy(core->event);
-    KFMutexDestroy(core->mutex);
     free(notify);
 }
 
@@ -56,18 +58,12 @@ int KF_SYS_CALL KFCompletionNotifyTryWake(void* notify)
     if (notify == NULL)
         return 0;
     
-    int result = 0;
-    
     KFCompletionNotify* core = (KFCompletionNotify*)notify;
-    KFMutexLock(core->mutex); //锁定多线程，保证加法操作线程安全
-    core->dynamicCount += 1; //完成一个任务+1
-    if (core->dynamicCount == core->fixedCount) { //所有任务都已经完成
-        KFEventSet(core->event); //通知事件，KFCompletionNotifyWait返回
-        result = 1;
-    }
-    KFMutexUnlock(core->mutex);
-    
-    return result;
+    if (KF_NOTIFY_ADD(&core->dynamicCount, 1) != core->fixedCount) //完成一个任务+1
+        return 0;
+
+    KFEventSet(core->event); //所有任务都已经完成，通知事件，KFCompletionNotifyWait返回
+    return 1;
 }
 
 void KF_SYS_CALL KFCompletionNotifyForceWake(void* notify, int result)
@@ -76,13 +72,15 @@ void KF_SYS_CALL KFCompletionNotifyForceWake(void* notify, int result)
         return;
     
     KFCompletionNotify* core = (KFCompletionNotify*)notify;
-    KFMutexLock(core->mutex);
-    if (core->dynamicCount != core->fixedCount) { //只有在不相等的情况下
-        core->dynamicCount = core->fixedCount;
-        core->forceWaked = result;
-        KFEventSet(core->event); //强制唤醒KFCompletionNotifyWait
+    for (;;) {
+        int count = KF_NOTIFY_LOAD(&core->dynamicCount);
+        if (count == core->fixedCount) //只有在不相等的情况下
+            return;
+        if (KF_NOTIFY_CAS(&core->dynamicCount, count, core->fixedCount))
+            break;
     }
-    KFMutexUnlock(core->mutex);
+    KF_NOTIFY_SWAP(&core->forceWaked, result);
+    KFEventSet(core->event); //强制唤醒KFCompletionNotifyWait
 }
 
 int KF_SYS_CALL KFCompletionNotifyWait(void* notify)
@@ -90,26 +88,8 @@ int KF_SYS_CALL KFCompletionNotifyWait(void* notify)
     if (notify == NULL)
         return 0;
     
-    int result = 0;
-    
     KFCompletionNotify* core = (KFCompletionNotify*)notify;
-    KFMutexLock(core->mutex);
-    if (core->dynamicCount == core->fixedCount) {
-        //如果一进入wait方法就任务就已经全部完成，则reset后直接返回
-        core->dynamicCount = 0;
-        KFEventReset(core->event);
-    }else{
-        //不然则进入等待
-        KFMutexUnlock(core->mutex);
-        KFEventWait(core->event); //等待唤醒
-        KFMutexLock(core->mutex);
-        core->dynamicCount = 0; //reset任务完成计数
-        if (core->forceWaked != 0) { //如果是强制wake的情况，拿返回值
-            result = core->forceWaked;
-            core->forceWaked = 0;
-        }
-    }
-    KFMutexUnlock(core->mutex);
-    
-    return result;
+    KFEventWait(core->event); //等待唤醒（auto-reset，如果已经全部完成会立即返回）
+    KF_NOTIFY_SWAP(&core->dynamicCount, 0); //reset任务完成计数
+    return KF_NOTIFY_SWAP(&core->forceWaked, 0); //如果是强制wake的情况，拿返回值
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#include "kf_sys_platform.h"
 #include <stdlib.h>
 #ifndef _MSC_VER
+#include <time.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -16,6 +17,7 @@
 #define _RAND_WIN32
 #endif
 #ifdef __linux__
+#include <stdio.h>
 #if __GLIBC__ > 2 || __GLIBC_MINOR__ > 24
 #include <sys/random.h>
 #define _RAND_LINUX
@@ -80,6 +82,88 @@ int KF_SYS_CALL KFSystemCpuCount(void)
 #endif
 }
 
+#ifdef __linux__
+static int LinuxReadNodeCpuList(int node, int* cpus, int max_count)
+{
+    char path[128];
+    sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+
+    //格式为 "0-3,8-11"
+    int count = 0, first = 0, last = 0;
+    char sep = 0;
+    while (fscanf(fp, "%d", &first) == 1) {
+        last = first;
+        if (fscanf(fp, "%c", &sep) == 1 && sep == '-') {
+            if (fscanf(fp, "%d", &last) != 1)
+                break;
+            if (fscanf(fp, "%c", &sep) != 1)
+                sep = 0;
+        }
+        for (int i = first; i <= last; i++, count++)
+            if (cpus && count < max_count)
+                cpus[count] = i;
+        if (sep != ',')
+            break;
+    }
+    fclose(fp);
+    return count;
+}
+#endif
+
+int KF_SYS_CALL KFSystemNumaNodeCount(void)
+{
+#ifdef _MSC_VER
+    ULONG highest = 0;
+    if (!GetNumaHighestNodeNumber(&highest))
+        return 1;
+    return (int)highest + 1;
+#elif defined(__linux__)
+    int count = 0;
+    while (LinuxReadNodeCpuList(count, NULL, 0) >= 0)
+        count++;
+    return count > 0 ? count : 1;
+#else
+    return 1;
+#endif
+}
+
+int KF_SYS_CALL KFSystemNumaNodeCpus(int node, int* cpus, int max_count)
+{
+    if (node < 0)
+        return 0;
+#ifdef _MSC_VER
+    ULONGLONG mask = 0;
+    if (!GetNumaNodeProcessorMask((UCHAR)node, &mask))
+        return 0;
+    int count = 0;
+    for (int i = 0; i < 64; i++) {
+        if (mask & (((ULONGLONG)1) << i)) {
+            if (cpus && count < max_count)
+                cpus[count] = i;
+            count++;
+        }
+    }
+    return count;
+#else
+    int count;
+#ifdef __linux__
+    count = LinuxReadNodeCpuList(node, cpus, max_count);
+    if (count >= 0)
+        return count;
+#endif
+    //没有 NUMA 信息，所有 CPU 都在节点 0 上
+    if (node != 0)
+        return 0;
+    count = KFSystemCpuCount();
+    for (int i = 0; cpus && i < count && i < max_count; i++)
+        cpus[i] = i;
+    return count;
+#endif
+}
+
 long long KF_SYS_CALL KFGetTick(void) //ms
 {
 #ifdef _MSC_VER
@@ -87,9 +171,20 @@ long long KF_SYS_CALL KFGetTick(void) //ms
 #elif __APPLE__
     return MachGetTicksNs() / 1000000;
 #else
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return KFGetMonotonicNs() / 1000000;
+#endif
+}
+
+long long KF_SYS_CALL KFGetMonotonicNs(void)
+{
+#ifdef _MSC_VER
+    return Win32GetTicks100ns() * 100;
+#elif __APPLE__
+    return (long long)MachGetTicksNs();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
 #endif
 }
 
@@ -52,6 +52,8 @@ void  KF_SYS_CALL KFThreadInit(KFThread* t);
 void* KF_SYS_CALL KFThreadPlatformObject(KFThread* t);
 
 void  KF_SYS_CALL KFSwitchToThread();
+int   KF_SYS_CALL KFThreadSetAffinity(KFThread* t, const int* cpus, int count); //t 为 NULL 表示当前线程，成功返回 1（macOS 不支持）
+void  KF_SYS_CALL KFCpuRelax(); //自旋等待时调用（pause/yield 指令），不会让出线程
 
 // ***** Event ***** //
 
@@ -65,11 +67,16 @@ void  KF_SYS_CALL KFSwitchToThread();
 #define KFEventReset(event) ((int)ResetEvent((event)))
 #define KFEventWait(event) WaitForSingleObjectEx((event), INFINITE, FALSE)
 #else
+#ifdef __linux__
+#define KF_EVENT_USE_FUTEX 1
+#endif
 typedef struct {
-    int state;
+    int state; //Linux 下同时是 futex 的等待地址（并且记录是否有线程在等待）
     int manual_reset;
+#ifndef KF_EVENT_USE_FUTEX
     pthread_mutex_t mutex;
     pthread_cond_t cond_var;
+#endif
 } KFEvent;
     
 void* KF_SYS_CALL KFEventCreate(int init_state, int manual_reset);
@@ -108,9 +115,12 @@ int   KF_SYS_CALL KFCondVarWaitTimed(void* cv, void* mutex, int time_out_ms);
 // ***** Misc ***** //
 
 int KF_SYS_CALL KFSystemCpuCount(void);
+int KF_SYS_CALL KFSystemNumaNodeCount(void); //至少为 1
+int KF_SYS_CALL KFSystemNumaNodeCpus(int node, int* cpus, int max_count); //取得 NUMA 节点上的 CPU 编号，返回个数
 
-long long KF_SYS_CALL KFGetTick(void);
-long long KF_SYS_CALL KFGetTime(void);
+long long KF_SYS_CALL KFGetTick(void); //单调时钟（毫秒），不受系统时间调整的影响，只用于计算时间差
+long long KF_SYS_CALL KFGetTime(void); //系统时间（微秒，1970 年开始）
+long long KF_SYS_CALL KFGetMonotonicNs(void); //单调时钟（纳秒），起点不确定，只用于计算时间差
 long long KF_SYS_CALL KFGetTimeTick(void);
 
 void KF_SYS_CALL KFSleep(int sleep_ms);
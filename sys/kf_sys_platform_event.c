@@ -4,6 +4,124 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <time.h>
+#ifdef KF_EVENT_USE_FUTEX
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef KF_EVENT_USE_FUTEX
+//state 是唯一的 futex 字：0（未触发）、1（已触发）、2（未触发，并且可能有线程在 futex 上等待）
+//等待者睡眠前把 0 改成 2，Set 用一次 exchange 改成 1，只有旧值是 2 时才进入内核唤醒，所以没有等待者时 Set 不会进入内核，
+//也不会丢失唤醒（FUTEX_WAIT 在内核中再检查一次 state 仍然为 2 才睡眠）
+//Set 在 exchange 之后不再读写 Event 的任何字段：等待者看到 1 就可以返回并且销毁 Event（KFThreadObject 启动、KFCompletionNotify 都是这样用的），
+//之后的 FUTEX_WAKE 只把地址交给内核，地址已经释放时最多是一次多余的唤醒
+#define KF_FUTEX_UNSET   0
+#define KF_FUTEX_SET     1
+#define KF_FUTEX_WAITING 2
+
+static int KFFutexWait(int* addr, int value, const struct timespec* timeout)
+{ return (int)syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0); }
+static void KFFutexWake(int* addr, int count)
+{ syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0); }
+
+//取走触发状态（auto-reset 的 Event 清除状态），成功返回 1
+//contended 表示调用者睡眠过：其他等待者可能还在 futex 上，清除时留下 KF_FUTEX_WAITING，下一次 Set 仍然会唤醒它们
+static int KFEventTryAcquire(KFEvent* e, int contended)
+{
+    if (e->manual_reset)
+        return __atomic_load_n(&e->state, __ATOMIC_SEQ_CST) == KF_FUTEX_SET;
+    int expected = KF_FUTEX_SET;
+    return __atomic_compare_exchange_n(&e->state, &expected, contended ? KF_FUTEX_WAITING : KF_FUTEX_UNSET,
+        0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+//deadline_ns < 0 表示一直等待，返回 KF_EVENT_COMPLETE 或者 KF_EVENT_TIME_OUT
+static int KFEventFutexWait(KFEvent* e, long long deadline_ns)
+{
+    int contended = 0;
+    while (!KFEventTryAcquire(e, contended)) {
+        //标记有等待者，Set 在这之后一定会进入内核；state 已经是 1 时回到循环取走
+        int expected = KF_FUTEX_UNSET;
+        if (!__atomic_compare_exchange_n(&e->state, &expected, KF_FUTEX_WAITING, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) &&
+            expected == KF_FUTEX_SET)
+            continue;
+
+        contended = 1;
+        if (deadline_ns < 0) {
+            KFFutexWait(&e->state, KF_FUTEX_WAITING, NULL);
+            continue;
+        }
+        long long remain = deadline_ns - KFGetMonotonicNs();
+        if (remain <= 0)
+            return KF_EVENT_TIME_OUT; //留下的 KF_FUTEX_WAITING 最多让下一次 Set 多进入一次内核
+        struct timespec timeout;
+        timeout.tv_sec = (time_t)(remain / 1000000000LL);
+        timeout.tv_nsec = (long)(remain % 1000000000LL);
+        KFFutexWait(&e->state, KF_FUTEX_WAITING, &timeout); //EINTR/EAGAIN/ETIMEDOUT 都回到循环重新检查
+    }
+    return KF_EVENT_COMPLETE;
+}
+
+void* KF_SYS_CALL KFEventCreate(int init_state, int manual_reset)
+{
+    KFEvent* e = (KFEvent*)malloc(sizeof(KFEvent));
+    if (e == NULL)
+        return NULL;
+
+    e->state = init_state ? KF_FUTEX_SET : KF_FUTEX_UNSET;
+    e->manual_reset = manual_reset;
+    return e;
+}
+
+void KF_SYS_CALL KFEventDestroy(void* event)
+{
+    if (event)
+        free(event);
+}
+
+int KF_SYS_CALL KFEventSet(void* event)
+{
+    if (event == NULL)
+        return 0;
+
+    KFEvent* e = (KFEvent*)event;
+    int wake_count = e->manual_reset ? INT_MAX : 1; //exchange 之后 Event 可能已经被销毁，先读出来
+    if (__atomic_exchange_n(&e->state, KF_FUTEX_SET, __ATOMIC_SEQ_CST) == KF_FUTEX_WAITING)
+        KFFutexWake(&e->state, wake_count);
+    return 1;
+}
+
+int KF_SYS_CALL KFEventReset(void* event)
+{
+    if (event == NULL)
+        return 0;
+
+    //只清除已触发的状态，不能抹掉 KF_FUTEX_WAITING
+    KFEvent* e = (KFEvent*)event;
+    int expected = KF_FUTEX_SET;
+    __atomic_compare_exchange_n(&e->state, &expected, KF_FUTEX_UNSET, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return 1;
+}
+
+void KF_SYS_CALL KFEventWait(void* event)
+{
+    if (event)
+        KFEventFutexWait((KFEvent*)event, -1);
+}
+
+int KF_SYS_CALL KFEventWaitTimed(void* event, int time_out_ms)
+{
+    if (event == NULL)
+        return -1;
+    if (time_out_ms < 0)
+        time_out_ms = 0;
+    return KFEventFutexWait((KFEvent*)event, KFGetMonotonicNs() + (long long)time_out_ms * 1000000LL);
+}
+
+#else
 
 void* KF_SYS_CALL KFEventCreate(int init_state, int manual_reset)
 {
@@ -17,7 +135,16 @@ void* KF_SYS_CALL KFEventCreate(int init_state, int manual_reset)
         free(e);
         return NULL;
     }
-    if (pthread_cond_init(&e->cond_var, NULL)) {
+#ifndef __APPLE__
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); //超时不受系统时间调整的影响
+    int cond_result = pthread_cond_init(&e->cond_var, &attr);
+    pthread_condattr_destroy(&attr);
+#else
+    int cond_result = pthread_cond_init(&e->cond_var, NULL);
+#endif
+    if (cond_result) {
         pthread_mutex_destroy(&e->mutex);
         free(e);
         return NULL;
@@ -88,20 +215,28 @@ int KF_SYS_CALL KFEventWaitTimed(void* event, int time_out_ms)
         return -1;
     
     struct timespec time;
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    time.tv_sec = tv.tv_sec + time_out_ms / 1000;
-    time.tv_nsec = tv.tv_usec * 1000 + (time_out_ms % 1000) * 1000000;
+#ifdef __APPLE__
+    time.tv_sec = time_out_ms / 1000; //macOS 没有 pthread_condattr_setclock，使用相对时间
+    time.tv_nsec = (time_out_ms % 1000) * 1000000;
+#else
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    time.tv_sec += time_out_ms / 1000;
+    time.tv_nsec += (time_out_ms % 1000) * 1000000;
     if (time.tv_nsec >= 1000000000) {
         time.tv_nsec -= 1000000000;
         time.tv_sec++;
     }
+#endif
     
     int wait_result = 0;
     KFEvent* e = (KFEvent*)event;
     pthread_mutex_lock(&e->mutex);
     if (!e->state) {
+#ifdef __APPLE__
+        wait_result = pthread_cond_timedwait_relative_np(&e->cond_var, &e->mutex, &time);
+#else
         wait_result = pthread_cond_timedwait(&e->cond_var, &e->mutex, &time);
+#endif
         if (wait_result != 0 && wait_result != ETIMEDOUT) {
             pthread_mutex_unlock(&e->mutex);
             return -1;
@@ -113,6 +248,7 @@ int KF_SYS_CALL KFEventWaitTimed(void* event, int time_out_ms)
     return wait_result == 0 ? KF_EVENT_COMPLETE : KF_EVENT_TIME_OUT;
 }
 
+#endif //KF_EVENT_USE_FUTEX
 #else
 
 int KF_SYS_CALL KFEventWaitTimed(void* e, int time_out_ms)
@@ -1,8 +1,12 @@
 ﻿#include "kf_sys_platform.h"
 #include <stdlib.h>
 #ifndef _MSC_VER
+#include <time.h>
 #include <sys/time.h>
 #include <errno.h>
+#ifndef __APPLE__
+#define KF_CONDVAR_MONOTONIC 1 //条件变量使用 CLOCK_MONOTONIC 计算超时（macOS 使用相对时间的等待）
+#endif
 #else
 #pragma warning(disable:4100)
 #endif
@@ -121,7 +125,15 @@ void* KF_SYS_CALL KFCondVarCreate()
     InitializeConditionVariable((PCONDITION_VARIABLE)result);
 #else
     result = malloc(sizeof(pthread_cond_t));
+#ifdef KF_CONDVAR_MONOTONIC
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init((pthread_cond_t*)result, &attr);
+    pthread_condattr_destroy(&attr);
+#else
     pthread_cond_init((pthread_cond_t*)result, NULL);
+#endif
 #endif
     return result;
 }
@@ -174,10 +186,9 @@ int KF_SYS_CALL KFCondVarWaitTimed(void* cv, void* mutex, int time_out_ms)
     int wait_result = pthread_cond_timedwait_relative_np((pthread_cond_t*)cv, (pthread_mutex_t*)mutex, &time);
 #else
     struct timespec time;
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    time.tv_sec = tv.tv_sec + time_out_ms / 1000;
-    time.tv_nsec = tv.tv_usec * 1000 + (time_out_ms % 1000) * 1000000;
+    clock_gettime(CLOCK_MONOTONIC, &time); //和 KFCondVarCreate 设置的时钟一致，系统时间调整不会提前或者推迟超时
+    time.tv_sec += time_out_ms / 1000;
+    time.tv_nsec += (time_out_ms % 1000) * 1000000;
     if (time.tv_nsec >= 1000000000) {
         time.tv_nsec -= 1000000000;
         time.tv_sec++;
@@ -1,4 +1,7 @@
-﻿#include "kf_sys_platform.h"
+﻿#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE //pthread_setaffinity_np
+#endif
+#include "kf_sys_platform.h"
 #include <stdlib.h>
 #include <memory.h>
 #ifdef _MSC_VER
@@ -32,11 +35,9 @@ static DWORD CALLBACK Win32_ThreadProc(LPVOID data)
     WakeConditionVariable(&t->cvar);
     LeaveCriticalSection(&t->mutex);
 
-    CRITICAL_SECTION mutex = t->mutex;
     CoInitialize(NULL);
     all_platform_entry(t);
     CoUninitialize();
-    DeleteCriticalSection(&mutex);
     return 0;
 }
 #else
@@ -52,11 +53,7 @@ static void* unix_thread_proc(void* data)
     pthread_cond_signal(&t->cvar);
     pthread_mutex_unlock(&t->mutex);
     
-    pthread_mutex_t mutex = t->mutex;
-    pthread_cond_t cvar = t->cvar;
     all_platform_entry(t);
-    pthread_mutex_destroy(&mutex);
-    pthread_cond_destroy(&cvar);
     return NULL;
 }
 #endif
@@ -74,13 +71,15 @@ int KF_SYS_CALL KFThreadCreate(KFThread* t, int (*fn)(void*), void* data, const
     t->thread = CreateThread(NULL, 0, &Win32_ThreadProc, t, 0, NULL);
     if (t->thread == NULL) {
         GetLastError();
+        DeleteCriticalSection(&t->mutex);
         return 0;
     }
 
     EnterCriticalSection(&t->mutex);
-    if (!t->waked)
+    while (!t->waked)
         SleepConditionVariableCS(&t->cvar, &t->mutex, INFINITE);
     LeaveCriticalSection(&t->mutex);
+    DeleteCriticalSection(&t->mutex); //线程已经启动，不会再使用
     return 1;
 #else
     pthread_mutex_init(&t->mutex, NULL);
@@ -91,14 +90,19 @@ int KF_SYS_CALL KFThreadCreate(KFThread* t, int (*fn)(void*), void* data, const
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
     if (pthread_create(&t->thread, created_detach > 0 ? &attr : NULL, &unix_thread_proc, t) != 0) {
         pthread_attr_destroy(&attr);
+        pthread_cond_destroy(&t->cvar);
+        pthread_mutex_destroy(&t->mutex);
         return 0;
     }
     pthread_attr_destroy(&attr);
     
     pthread_mutex_lock(&t->mutex);
-    if (!t->waked)
+    while (!t->waked)
         pthread_cond_wait(&t->cvar, &t->mutex);
     pthread_mutex_unlock(&t->mutex);
+    //新线程已经不再使用这两个对象（不能在新线程中销毁拷贝，拷贝的 cond 还记录着这里的等待者，会永远阻塞）
+    pthread_cond_destroy(&t->cvar);
+    pthread_mutex_destroy(&t->mutex);
     return 1;
 #endif
 }
@@ -167,4 +171,46 @@ void KF_SYS_CALL KFSwitchToThread()
 #else
     sched_yield(); // pthread_yield();
 #endif
+}
+
+int KF_SYS_CALL KFThreadSetAffinity(KFThread* t, const int* cpus, int count)
+{
+    if (cpus == NULL || count <= 0)
+        return 0;
+#ifdef _MSC_VER
+    DWORD_PTR mask = 0;
+    for (int i = 0; i < count; i++)
+        if (cpus[i] >= 0 && cpus[i] < (int)(sizeof(DWORD_PTR) * 8))
+            mask |= ((DWORD_PTR)1) << cpus[i];
+    if (mask == 0)
+        return 0;
+    HANDLE thread = (t == NULL ? GetCurrentThread() : t->thread);
+    if (thread == NULL)
+        return 0;
+    return SetThreadAffinityMask(thread, mask) != 0 ? 1 : 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < count; i++)
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &set);
+    if (CPU_COUNT(&set) == 0)
+        return 0;
+    if (t != NULL && t->thread == 0)
+        return 0; //detach 的线程没有保存句柄，只能在线程内设置
+    return pthread_setaffinity_np(t == NULL ? pthread_self() : t->thread, sizeof(set), &set) == 0 ? 1 : 0;
+#else
+    return 0; //macOS 没有绑定核心的接口（只有 affinity tag 提示）
+#endif
+}
+
+void KF_SYS_CALL KFCpuRelax()
+{
+#ifdef _MSC_VER
+    YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
 }
\ No newline at end of file
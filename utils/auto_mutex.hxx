@@ -1,6 +1,7 @@
 ﻿#ifndef __KF_UTIL__AUTO_MUTEX_H
 #define __KF_UTIL__AUTO_MUTEX_H
 
+#include <atomic>
 #include <sys/kf_sys_platform.h>
 #include <base/kf_base.hxx>
 
@@ -85,4 +86,42 @@ public:
     };
 };
 
+//不需要创建系统对象的自旋锁，只用于保护很短的临界区（不可重入）
+class KFSpinLock final
+{
+    std::atomic_flag _flag = ATOMIC_FLAG_INIT;
+
+public:
+    KFSpinLock() throw() {}
+
+    KFSpinLock(const KFSpinLock&) = delete;
+    KFSpinLock& operator=(const KFSpinLock&) = delete;
+
+public:
+    void Lock() throw()
+    {
+        int spin = 0;
+        while (_flag.test_and_set(std::memory_order_acquire)) {
+            if (++spin >= 64) {
+                KFSwitchToThread(); //持有者可能被调度走了
+                spin = 0;
+            }
+        }
+    }
+    void Unlock() throw() { _flag.clear(std::memory_order_release); }
+
+public:
+    class AutoLock final
+    {
+        KFSpinLock& _lock;
+
+    public:
+        explicit AutoLock(KFSpinLock& m) throw() : _lock(m) { _lock.Lock(); }
+        ~AutoLock() throw() { _lock.Unlock(); }
+
+        AutoLock(const AutoLock&) = delete;
+        AutoLock& operator=(const AutoLock&) = delete;
+    };
+};
+
 #endif //__KF_UTIL_AUTO_MUTEX_H
\ No newline at end of file
@@ -1,6 +1,6 @@
 ﻿#include "logger_fileio.hxx"
 
-KF_RESULT DbgFileLogger::Start(const char* file, LoggerOutputCallback outputCB)
+KF_RESULT DbgFileLogger::Start(const char* file, LoggerOutputCallback outputCB, bool use_strand)
 {
     _logCount = 0;
     _outputCB = outputCB;
@@ -12,6 +12,8 @@ KF_RESULT DbgFileLogger::Start(const char* file, LoggerOutputCallback outputCB)
             return KF_ACCESS_DENIED;
     }
 
+    if (use_strand)
+        return KFAsyncCreateStrand(nullptr, &_worker);
     return KFAsyncCreateWorker(false, 1, &_worker);
 }
 
@@ -32,7 +32,8 @@ public:
     { KF_IMPL_RECYCLE_FUNC(_ref_count); }
 
 public:
-    KF_RESULT Start(const char* file, LoggerOutputCallback outputCB = nullptr);
+    //use_strand：在全局并行 Worker 的 Strand 上写日志，不单独创建线程（需要先 KFAsyncStartup）
+    KF_RESULT Start(const char* file, LoggerOutputCallback outputCB = nullptr, bool use_strand = false);
     KF_RESULT Stop(bool flush = true);
 
     KF_RESULT Post(const char* str, int* tick = nullptr);
@@ -0,0 +1,64 @@
+﻿#ifndef __KF_UTIL__MPSC_QUEUE_H
+#define __KF_UTIL__MPSC_QUEUE_H
+
+#include <atomic>
+#include <base/kf_base.hxx>
+
+//多生产者单消费者的无锁队列（侵入式，Node 需要有 std::atomic<Node*> Next 成员）
+//Push 可以在任意线程调用，Pop 同一时刻只能有一个消费者调用
+template<typename Node>
+class MpscQueue
+{
+public:
+    MpscQueue() throw() : _head(&_stub), _tail(&_stub)
+    { _stub.Next.store(nullptr, std::memory_order_relaxed); }
+    ~MpscQueue() throw() {}
+
+    KF_DISALLOW_COPY_AND_ASSIGN(MpscQueue)
+
+public:
+    void Push(Node* node) throw() { PushChain(node, node); }
+
+    //提交一串已经用 Next 连接好的节点（first -> ... -> last），只需要一次原子操作
+    void PushChain(Node* first, Node* last) throw()
+    {
+        last->Next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = _head.exchange(last, std::memory_order_acq_rel);
+        prev->Next.store(first, std::memory_order_release);
+    }
+
+    //返回 nullptr 表示队列为空，或者生产者正在入队的中途（稍后重试即可）
+    Node* Pop() throw()
+    {
+        Node* tail = _tail;
+        Node* next = tail->Next.load(std::memory_order_acquire);
+        if (tail == &_stub) {
+            if (next == nullptr)
+                return nullptr;
+            _tail = next;
+            tail = next;
+            next = next->Next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        if (tail != _head.load(std::memory_order_acquire))
+            return nullptr;
+
+        Push(&_stub);
+        next = tail->Next.load(std::memory_order_acquire);
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        return nullptr;
+    }
+
+private:
+    std::atomic<Node*> _head; //生产者端
+    Node* _tail; //消费者端
+    Node _stub;
+};
+
+#endif //__KF_UTIL__MPSC_QUEUE_H
\ No newline at end of file
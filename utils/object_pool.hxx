@@ -0,0 +1,141 @@
+﻿#ifndef __KF_UTIL__OBJECT_POOL_H
+#define __KF_UTIL__OBJECT_POOL_H
+
+#include <new>
+#include <stdlib.h>
+#include <utils/auto_mutex.hxx>
+
+//定长对象的内存池：每个线程有自己的缓存（不需要加锁），超出缓存的部分放回全局列表（自旋锁保护）
+//典型用法是在类里重载 operator new/delete，生产者线程分配、工作线程释放的对象会通过全局列表流回生产者
+//T 只用于区分不同的池，块大小固定为 sizeof(T)
+template<typename T, int CacheCount = 256, int GlobalCount = 4096>
+class KFObjectPool
+{
+    struct Block { Block* Next; };
+    struct ThreadCache
+    {
+        Block* Head;
+        int Count;
+        ~ThreadCache() throw()
+        {
+            //线程退出时把缓存还给全局列表，之后这个线程释放的块直接进全局列表
+            KFObjectPool::ReleaseChain(Head, Count);
+            Head = nullptr;
+            Count = -1;
+        }
+    };
+
+    static_assert(CacheCount >= 2, "CacheCount");
+
+public:
+    static void* Alloc(std::size_t size) throw()
+    {
+        if (size > sizeof(T))
+            return malloc(size); //派生类不使用内存池
+
+        auto& cache = _cache;
+        if (cache.Count == 0)
+            cache.Count = AcquireChain(&cache.Head, CacheCount / 2); //从全局列表批量取回
+        if (cache.Count > 0) {
+            auto block = cache.Head;
+            cache.Head = block->Next;
+            cache.Count--;
+            return block;
+        }
+        return malloc(BlockSize());
+    }
+
+    static void Free(void* p) throw()
+    {
+        if (p == nullptr)
+            return;
+
+        auto block = static_cast<Block*>(p);
+        auto& cache = _cache;
+        if (cache.Count < 0) {
+            ReleaseChain(block, 1);
+            return;
+        }
+
+        block->Next = cache.Head;
+        cache.Head = block;
+        if (++cache.Count < CacheCount)
+            return;
+
+        //本线程缓存满了（一般是只释放不分配的工作线程），把一半还给全局列表
+        Block* last = cache.Head;
+        for (int i = 1; i < CacheCount / 2; i++)
+            last = last->Next;
+        auto chain = cache.Head;
+        cache.Head = last->Next;
+        last->Next = nullptr;
+        cache.Count -= CacheCount / 2;
+        ReleaseChain(chain, CacheCount / 2);
+    }
+
+private:
+    static std::size_t BlockSize() throw()
+    { return sizeof(T) > sizeof(Block) ? sizeof(T) : sizeof(Block); }
+
+    static int AcquireChain(Block** head, int count) throw()
+    {
+        KFSpinLock::AutoLock lock(_global_lock);
+        int n = 0;
+        Block* first = _global_head;
+        Block* last = nullptr;
+        for (Block* b = first; b != nullptr && n < count; b = b->Next, n++)
+            last = b;
+        if (n == 0)
+            return 0;
+        _global_head = last->Next;
+        _global_count -= n;
+        last->Next = nullptr;
+        *head = first;
+        return n;
+    }
+
+    static void ReleaseChain(Block* chain, int count) throw()
+    {
+        while (chain != nullptr && count > 0) {
+            auto next = chain->Next;
+            {
+                KFSpinLock::AutoLock lock(_global_lock);
+                if (_global_count < GlobalCount) {
+                    chain->Next = _global_head;
+                    _global_head = chain;
+                    _global_count++;
+                    chain = nullptr;
+                }
+            }
+            if (chain)
+                free(chain); //全局列表已满，还给系统
+            chain = next;
+            count--;
+        }
+    }
+
+    static thread_local ThreadCache _cache;
+    static KFSpinLock _global_lock;
+    static Block* _global_head;
+    static int _global_count;
+};
+
+template<typename T, int CacheCount, int GlobalCount>
+thread_local typename KFObjectPool<T, CacheCount, GlobalCount>::ThreadCache KFObjectPool<T, CacheCount, GlobalCount>::_cache = {nullptr, 0};
+template<typename T, int CacheCount, int GlobalCount>
+KFSpinLock KFObjectPool<T, CacheCount, GlobalCount>::_global_lock;
+template<typename T, int CacheCount, int GlobalCount>
+typename KFObjectPool<T, CacheCount, GlobalCount>::Block* KFObjectPool<T, CacheCount, GlobalCount>::_global_head = nullptr;
+template<typename T, int CacheCount, int GlobalCount>
+int KFObjectPool<T, CacheCount, GlobalCount>::_global_count = 0;
+
+//在类的开头使用：KF_IMPL_OBJECT_POOL(ClassName)，之后 new(std::nothrow)/delete 都会走内存池
+#define KF_IMPL_OBJECT_POOL(cls) \
+    public: \
+    static void* operator new(std::size_t size, const std::nothrow_t&) throw() { return KFObjectPool<cls>::Alloc(size); } \
+    static void* operator new(std::size_t size) { void* p = KFObjectPool<cls>::Alloc(size); if (p == nullptr) throw std::bad_alloc(); return p; } \
+    static void operator delete(void* p) throw() { KFObjectPool<cls>::Free(p); } \
+    static void operator delete(void* p, const std::nothrow_t&) throw() { KFObjectPool<cls>::Free(p); } \
+    private:
+
+#endif //__KF_UTIL__OBJECT_POOL_H
\ No newline at end of file